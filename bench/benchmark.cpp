@@ -0,0 +1,327 @@
+#include "../include/delaunay.hpp"
+#include "../include/voronoi.hpp"
+#include "../include/ioFunctions.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unistd.h>
+
+/*
+ * Scaling benchmark: for each input shape and size, generate the sites into a file and run the whole pipeline on
+ * it (readPoints, Delaunay, Voronoi, printVoronoi), timing each stage. The first runs are warm-up and are not
+ * recorded. The text output goes to /dev/null, so printVoronoi measures the formatting, not the disk.
+ *
+ * Each stage is appended to the output as a CSV row:
+ *
+ *   label,input,sites,stage,repetitions,median_ms,p95_ms
+ *
+ * so runs of different commits, told apart by the label, can be kept in one file and compared.
+ */
+
+typedef std::vector<std::pair<int, int>> SiteList;
+
+static int const coordinateRange = 1 << 24;
+
+static SiteList uniformSites(size_t n, std::mt19937 &rng)
+{
+  std::uniform_int_distribution<int> coordinate(0, coordinateRange);
+  SiteList sites(n);
+  for (auto &s : sites)
+    s = {coordinate(rng), coordinate(rng)};
+  return sites;
+}
+
+/**
+ * About one cluster per thousand sites, each one a normal distribution around a uniform center.
+ */
+static SiteList clusteredSites(size_t n, std::mt19937 &rng)
+{
+  std::uniform_int_distribution<int> coordinate(0, coordinateRange);
+  std::vector<std::pair<double, double>> centers(1 + n / 1000);
+  for (auto &c : centers)
+    c = {coordinate(rng), coordinate(rng)};
+
+  std::uniform_int_distribution<size_t> cluster(0, centers.size() - 1);
+  std::normal_distribution<double> offset(0.0, coordinateRange / 200.0);
+  SiteList sites(n);
+  for (auto &s : sites)
+  {
+    auto const &c = centers[cluster(rng)];
+    double x = std::min<double>(coordinateRange, std::max(0.0, c.first + offset(rng)));
+    double y = std::min<double>(coordinateRange, std::max(0.0, c.second + offset(rng)));
+    s = {int(x), int(y)};
+  }
+  return sites;
+}
+
+/**
+ * The points of a square integer grid, in random order: every cell has four cocircular corners.
+ */
+static SiteList latticeSites(size_t n, std::mt19937 &rng)
+{
+  size_t side = size_t(std::ceil(std::sqrt(double(n))));
+  SiteList sites;
+  sites.reserve(n);
+  for (size_t i = 0; sites.size() < n; i++)
+    sites.push_back({int(i % side), int(i / side)});
+  std::shuffle(sites.begin(), sites.end(), rng);
+  return sites;
+}
+
+/**
+ * Points along a slanted line, moved off it by at most one unit.
+ */
+static SiteList nearlyColinearSites(size_t n, std::mt19937 &rng)
+{
+  std::uniform_int_distribution<int> coordinate(0, coordinateRange);
+  std::uniform_int_distribution<int> jitter(-1, 1);
+  SiteList sites(n);
+  for (auto &s : sites)
+  {
+    int x = coordinate(rng);
+    s = {x, int(0.37 * x) + jitter(rng)};
+  }
+  return sites;
+}
+
+/**
+ * Points on a large circle, rounded to integers, so nearly all of them are on the convex hull.
+ */
+static SiteList hullSites(size_t n, std::mt19937 &rng)
+{
+  std::uniform_real_distribution<double> angle(0.0, 2 * M_PI);
+  double radius = coordinateRange / 2.0;
+  SiteList sites(n);
+  for (auto &s : sites)
+  {
+    double a = angle(rng);
+    s = {int(radius + std::round(radius * std::cos(a))), int(radius + std::round(radius * std::sin(a)))};
+  }
+  return sites;
+}
+
+struct Generator
+{
+  char const *name;
+  SiteList (*generate)(size_t, std::mt19937 &);
+};
+
+static Generator const generators[] = {
+    {"uniform", uniformSites},
+    {"clustered", clusteredSites},
+    {"lattice", latticeSites},
+    {"nearly-colinear", nearlyColinearSites},
+    {"hull", hullSites},
+};
+
+static char const *const stages[] = {"readPoints", "Delaunay", "Voronoi", "printVoronoi"};
+static int const numStages = 4;
+
+static void writeSites(SiteList const &sites, char const *path)
+{
+  std::ofstream out(path);
+  out << sites.size() << "\n";
+  for (auto const &s : sites)
+    out << s.first << " " << s.second << "\n";
+  if (!out)
+  {
+    std::cerr << "Could not write " << path << "\n";
+    exit(-1);
+  }
+}
+
+/**
+ * Run the pipeline once on the sites in path, storing the time of each stage in milliseconds in times.
+ */
+static void runPipeline(char const *path, DelaunayOptions const &options, double times[numStages])
+{
+  if (freopen(path, "r", stdin) == nullptr)
+  {
+    std::cerr << "Could not open " << path << "\n";
+    exit(-1);
+  }
+
+  typedef std::chrono::steady_clock Clock;
+  auto elapsed = [](Clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - since).count();
+  };
+
+  auto start = Clock::now();
+  std::vector<PointInt> storage;
+  pointIntVector sites;
+  readPoints(storage, sites, options.threads);
+  times[0] = elapsed(start);
+
+  start = Clock::now();
+  Delaunay delaunay(sites, options);
+  times[1] = elapsed(start);
+
+  start = Clock::now();
+  Voronoi vor(delaunay, options.threads);
+  times[2] = elapsed(start);
+
+  start = Clock::now();
+  printVoronoi(vor, options.threads);
+  std::cout.flush();
+  times[3] = elapsed(start);
+}
+
+/**
+ * Value at the given fraction of the sorted times, by nearest rank.
+ */
+static double percentile(std::vector<double> times, double fraction)
+{
+  std::sort(times.begin(), times.end());
+  size_t rank = size_t(std::ceil(fraction * times.size()));
+  return times[rank > 0 ? rank - 1 : 0];
+}
+
+static std::vector<std::string> splitList(char const *list)
+{
+  std::vector<std::string> items;
+  std::string item;
+  for (char const *c = list;; c++)
+  {
+    if (*c == ',' || *c == '\0')
+    {
+      if (!item.empty())
+        items.push_back(item);
+      item.clear();
+      if (*c == '\0')
+        return items;
+    }
+    else
+      item.push_back(*c);
+  }
+}
+
+static void usage()
+{
+  std::cerr << "usage: voronoiBench [--sizes N,N,...] [--inputs NAME,NAME,...] [--repetitions N] [--warmup N]\n"
+               "                    [--seed N] [--threads N] [--divide-and-conquer] [--tiled] [--tiles N] [--spatial-sort]\n"
+               "                    [--output FILE] [--label TEXT]\n"
+               "inputs: uniform, clustered, lattice, nearly-colinear, hull\n";
+  exit(-1);
+}
+
+int main(int argc, char **argv)
+{
+  std::vector<size_t> sizes = {1000, 10000, 100000, 1000000};
+  std::vector<Generator> inputs(std::begin(generators), std::end(generators));
+  int repetitions = 5, warmup = 1;
+  unsigned seed = 1;
+  DelaunayOptions options;
+  char const *outputPath = "bench.csv";
+  std::string label = "unlabeled";
+
+  for (int i = 1; i < argc; i++)
+  {
+    bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--sizes") == 0 && hasValue)
+    {
+      sizes.clear();
+      for (auto const &s : splitList(argv[++i]))
+        sizes.push_back(size_t(std::stod(s)));
+    }
+    else if (strcmp(argv[i], "--inputs") == 0 && hasValue)
+    {
+      inputs.clear();
+      for (auto const &name : splitList(argv[++i]))
+      {
+        auto g = std::find_if(std::begin(generators), std::end(generators), [&](Generator const &g) { return name == g.name; });
+        if (g == std::end(generators))
+          usage();
+        inputs.push_back(*g);
+      }
+    }
+    else if (strcmp(argv[i], "--repetitions") == 0 && hasValue)
+      repetitions = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--warmup") == 0 && hasValue)
+      warmup = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--seed") == 0 && hasValue)
+      seed = strtoul(argv[++i], nullptr, 10);
+    else if (strcmp(argv[i], "--threads") == 0 && hasValue)
+      options.threads = strtoul(argv[++i], nullptr, 10);
+    else if (strcmp(argv[i], "--divide-and-conquer") == 0)
+      options.engine = DelaunayEngine::divideAndConquer;
+    else if (strcmp(argv[i], "--tiled") == 0)
+      options.engine = DelaunayEngine::tiled;
+    else if (strcmp(argv[i], "--tiles") == 0 && hasValue)
+      options.tiles = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--spatial-sort") == 0)
+      options.spatialSort = true;
+    else if (strcmp(argv[i], "--output") == 0 && hasValue)
+      outputPath = argv[++i];
+    else if (strcmp(argv[i], "--label") == 0 && hasValue)
+      label = argv[++i];
+    else
+      usage();
+  }
+  if (repetitions < 1 || warmup < 0 || sizes.empty() || inputs.empty())
+    usage();
+
+  // the header is written once, so the results of several runs pile up in one file
+  bool exists = std::ifstream(outputPath).good();
+  std::ofstream results(outputPath, std::ios::app);
+  if (!results)
+  {
+    std::cerr << "Could not open " << outputPath << "\n";
+    exit(-1);
+  }
+  if (!exists)
+    results << "label,input,sites,stage,repetitions,median_ms,p95_ms\n";
+
+  char path[] = "/tmp/voronoiBenchXXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0)
+  {
+    std::cerr << "Could not create a temporary file\n";
+    exit(-1);
+  }
+  close(fd);
+  if (freopen("/dev/null", "w", stdout) == nullptr)
+  {
+    std::cerr << "Could not open /dev/null\n";
+    exit(-1);
+  }
+
+  for (auto const &input : inputs)
+  {
+    for (auto n : sizes)
+    {
+      std::mt19937 rng(seed);
+      writeSites(input.generate(n, rng), path);
+
+      std::vector<double> times[numStages];
+      double run[numStages];
+      for (int r = 0; r < warmup + repetitions; r++)
+      {
+        runPipeline(path, options, run);
+        if (r < warmup)
+          continue;
+        for (int s = 0; s < numStages; s++)
+          times[s].push_back(run[s]);
+      }
+
+      std::cerr << input.name << " " << n << ":";
+      for (int s = 0; s < numStages; s++)
+      {
+        double median = percentile(times[s], 0.5), p95 = percentile(times[s], 0.95);
+        results << label << ',' << input.name << ',' << n << ',' << stages[s] << ',' << repetitions << ',' << median << ',' << p95 << '\n';
+        std::cerr << " " << stages[s] << " " << median << " ms";
+      }
+      std::cerr << "\n";
+      results.flush();
+    }
+  }
+
+  remove(path);
+  return 0;
+}
@@ -0,0 +1,171 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <vector>
+#include <memory>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include "point.hpp"
+#include "halfEdge.hpp"
+#include "face.hpp"
+
+/**
+ * Storage for one object of the arena. While the slot is free it links to the next free slot.
+ *
+ * Types that need their destructor called also keep a flag, so the arena knows which slots to destroy on release.
+ */
+template <typename T, bool trivial = std::is_trivially_destructible<T>::value>
+struct ArenaSlot
+{
+  union
+  {
+    alignas(T) unsigned char storage[sizeof(T)];
+    ArenaSlot *next;
+  };
+};
+
+template <typename T>
+struct ArenaSlot<T, false>
+{
+  union
+  {
+    alignas(T) unsigned char storage[sizeof(T)];
+    ArenaSlot *next;
+  };
+  bool live = false;
+};
+
+/**
+ * Typed arena that hands out objects from contiguous slabs.
+ *
+ * Destroyed objects go to a free list and their slots are recycled by the next allocations.
+ * Every object is released at once when the arena is destroyed, or by reset, which keeps the slabs for reuse.
+ */
+template <typename T>
+class Arena
+{
+  typedef ArenaSlot<T> Slot;
+  static constexpr bool trivial = std::is_trivially_destructible<T>::value;
+
+public:
+  Arena(size_t slabSize = 1024) : slabSize(slabSize), used(slabSize), nextSlab(0), freeList(nullptr), count(0) {}
+
+  Arena(Arena const &) = delete;
+  Arena &operator=(Arena const &) = delete;
+
+  ~Arena() { release(); }
+
+  template <typename... Args>
+  T *create(Args &&...args)
+  {
+    Slot *slot;
+    if (freeList != nullptr)
+    {
+      slot = freeList;
+      freeList = slot->next;
+    }
+    else
+    {
+      if (used == slabSize)
+      {
+        if (nextSlab == slabs.size())
+          slabs.emplace_back(new Slot[slabSize]);
+        nextSlab++;
+        used = 0;
+      }
+      slot = &slabs[nextSlab - 1][used++];
+    }
+
+    T *obj = new (slot->storage) T(std::forward<Args>(args)...);
+    if constexpr (!trivial)
+      slot->live = true;
+    count++;
+    return obj;
+  }
+
+  void destroy(T *obj)
+  {
+    obj->~T();
+    auto slot = reinterpret_cast<Slot *>(obj);
+    if constexpr (!trivial)
+      slot->live = false;
+    slot->next = freeList;
+    freeList = slot;
+    count--;
+  }
+
+  /**
+   * Release every object. Slabs are simply dropped unless T has a destructor to run.
+   */
+  void release()
+  {
+    reset();
+    slabs.clear();
+  }
+
+  /**
+   * Destroy every object but keep the slabs, so the next allocations reuse their memory.
+   */
+  void reset()
+  {
+    if constexpr (!trivial)
+    {
+      for (size_t s = 0; s < nextSlab; s++)
+      {
+        size_t end = s + 1 == nextSlab ? used : slabSize;
+        for (size_t i = 0; i < end; i++)
+        {
+          if (slabs[s][i].live)
+            reinterpret_cast<T *>(slabs[s][i].storage)->~T();
+          slabs[s][i].live = false;
+        }
+      }
+    }
+    used = slabSize;
+    nextSlab = 0;
+    freeList = nullptr;
+    count = 0;
+  }
+
+  /**
+   * Number of live objects.
+   */
+  size_t size() const { return count; }
+
+private:
+  size_t slabSize;
+  // slots taken in the current slab, which is slabs[nextSlab - 1]; the slabs after it are spare
+  size_t used;
+  size_t nextSlab;
+  Slot *freeList;
+  size_t count;
+  std::vector<std::unique_ptr<Slot[]>> slabs;
+};
+
+/**
+ * The arenas backing one DCEL.
+ */
+template <typename T>
+struct DcelArena
+{
+  Arena<Point<T>> points;
+  Arena<HalfEdge<T>> edges;
+  Arena<Face<T>> faces;
+
+  void release()
+  {
+    edges.release();
+    faces.release();
+    points.release();
+  }
+
+  void reset()
+  {
+    edges.reset();
+    faces.reset();
+    points.reset();
+  }
+};
+
+#endif
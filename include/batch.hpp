@@ -0,0 +1,56 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <vector>
+#include <string>
+#include "delaunay.hpp"
+#include "voronoi.hpp"
+#include "bufferedWriter.hpp"
+
+/*
+ * Batch mode: many independent site sets, each one triangulated and printed like a single run of the program.
+ *
+ * The jobs run on a fixed pool of [options.threads] workers (0 means one per hardware thread), each of them with
+ * its own triangulation, diagram and site storage, which are reset for every job instead of allocated again. Each
+ * job uses the engine of options on one thread. The diagrams are written in the order of the jobs, a round of jobs
+ * at a time, so only the output of one round is held in memory.
+ *
+ * A job that fails, like a malformed site set or a file that can not be read, does not stop the batch: its
+ * diagram is replaced by a line "error <reason>" and the reason is also reported on the standard error. Return
+ * the number of jobs that failed.
+ */
+
+/**
+ * Triangulation, diagram and storage that a worker keeps from one site set to the next, so their memory is only
+ * allocated by the first sets.
+ */
+struct BatchWorker
+{
+  Delaunay delaunay;
+  Voronoi voronoi;
+  std::vector<PointInt> storage;
+  std::vector<PointInt *> sites;
+  // text of the current set, when it has to be read
+  std::vector<char> input;
+
+  /**
+   * Triangulate the site set in [begin, end), in the input format, on one thread. Write its diagram like
+   * printVoronoi to out, or its triangulation like printDelaunay if onlyDelaunay is set. Return an empty string,
+   * or the reason the set is invalid.
+   */
+  std::string run(char const *begin, char const *end, DelaunayOptions options, bool onlyDelaunay, BufferedWriter &out);
+};
+
+/**
+ * Jobs read from the standard input, a concatenation of site sets in the input format. The sets are delimited by
+ * their number of sites, so a set with a malformed coordinate fails alone; a count that is not a number ends the
+ * batch with a failed job.
+ */
+int runBatch(DelaunayOptions const &options);
+
+/**
+ * Jobs read from the files listed in a file, one path per line.
+ */
+int runBatchFiles(char const *listPath, DelaunayOptions const &options);
+
+#endif
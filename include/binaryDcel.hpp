@@ -0,0 +1,87 @@
+#ifndef BINARY_DCEL_H
+#define BINARY_DCEL_H
+
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+#include "compactDcel.hpp"
+
+/**
+ * Binary layout of a Voronoi diagram, meant to be mapped and used in place.
+ *
+ * The file is a header followed by five arrays, each one starting at an offset multiple of 8:
+ *
+ *   double x[numVertices], y[numVertices]
+ *   uint32_t vertexEdge[numVertices]
+ *   binary::EdgeRecord halfEdges[numHalfEdges]
+ *   binary::FaceRecord faces[numFaces]
+ *
+ * Everything is little-endian. Vertices, half-edges and faces are numbered as in the text output of printVoronoi,
+ * starting from 0 instead of 1, and references to nothing (the outer face, an isolated vertex) are none.
+ */
+namespace binary
+{
+  static constexpr char magic[8] = {'V', 'O', 'R', 'O', 'D', 'C', 'E', 'L'};
+  static constexpr uint32_t version = 1;
+  static constexpr uint32_t none = UINT32_MAX;
+
+  struct Header
+  {
+    char magic[8];
+    uint32_t version;
+    uint32_t numVertices;
+    uint32_t numHalfEdges;
+    uint32_t numFaces;
+  };
+
+  struct EdgeRecord
+  {
+    uint32_t origin, twin, face, next, prev;
+  };
+
+  /**
+   * A cell: one of its half-edges and its site.
+   */
+  struct FaceRecord
+  {
+    uint32_t edge;
+    int32_t siteX, siteY, siteId;
+  };
+}
+
+/**
+ * Write the diagram in the binary layout.
+ */
+void writeBinaryVoronoi(CompactDcel<double> const &dcel, std::ostream &out);
+
+/**
+ * Read-only view of a diagram in the binary layout, mapped from a file.
+ *
+ * Exit with an error if the file can not be mapped or is not a diagram of this version.
+ */
+class BinaryDcel
+{
+public:
+  BinaryDcel(char const *path);
+  ~BinaryDcel();
+
+  BinaryDcel(BinaryDcel const &) = delete;
+  BinaryDcel &operator=(BinaryDcel const &) = delete;
+
+  uint32_t numVertices() const { return header->numVertices; }
+  uint32_t numHalfEdges() const { return header->numHalfEdges; }
+  uint32_t numFaces() const { return header->numFaces; }
+
+public:
+  double const *x, *y;
+  uint32_t const *vertexEdge;
+  binary::EdgeRecord const *halfEdges;
+  binary::FaceRecord const *faces;
+
+private:
+  void const *mapped;
+  size_t length;
+  binary::Header const *header;
+};
+
+#endif
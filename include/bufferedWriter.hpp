@@ -0,0 +1,110 @@
+#ifndef BUFFERED_WRITER_H
+#define BUFFERED_WRITER_H
+
+#include <string>
+#include <ostream>
+#include <vector>
+#include <type_traits>
+#include <charconv>
+#include <algorithm>
+#include "threadPool.hpp"
+
+/**
+ * Text output formatted with std::to_chars into a large buffer, which is written to the stream when it fills up
+ * and when the writer is destroyed. A writer without a stream just keeps the text.
+ *
+ * Numbers are written as std::ostream writes them with its default settings: integers in decimal and doubles
+ * with 6 significant digits, like "%g".
+ */
+class BufferedWriter
+{
+public:
+  BufferedWriter(std::ostream *out = nullptr, size_t capacity = 1 << 20);
+  ~BufferedWriter();
+
+  BufferedWriter(BufferedWriter const &) = delete;
+  BufferedWriter &operator=(BufferedWriter const &) = delete;
+  BufferedWriter(BufferedWriter &&) = default;
+
+  template <typename T>
+  typename std::enable_if<std::is_integral<T>::value, BufferedWriter &>::type operator<<(T value)
+  {
+    char digits[24];
+    auto end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+    text.append(digits, end);
+    return commit();
+  }
+
+  BufferedWriter &operator<<(char c)
+  {
+    text.push_back(c);
+    return commit();
+  }
+
+  BufferedWriter &operator<<(double value);
+  BufferedWriter &operator<<(char const *s);
+  BufferedWriter &operator<<(BufferedWriter const &other);
+
+  /**
+   * Write the buffered text to the stream.
+   */
+  void flush();
+
+  /**
+   * Drop the buffered text without writing it, keeping the buffer.
+   */
+  void clear() { text.clear(); }
+
+  /**
+   * Text buffered so far, for a writer without a stream.
+   */
+  std::string const &buffered() const { return text; }
+
+  /**
+   * Format count lines, calling formatLine(i, writer) for each i in order. Large counts are split in chunks
+   * formatted on the pool, whose texts are appended in order.
+   */
+  template <typename F>
+  void formatLines(size_t count, ThreadPool *pool, F const &formatLine)
+  {
+    size_t const chunkSize = 1 << 14;
+    if (pool == nullptr || pool->size() == 1 || count <= chunkSize)
+    {
+      for (size_t i = 0; i < count; i++)
+        formatLine(i, *this);
+      return;
+    }
+
+    // chunks are formatted in rounds, so only a bounded amount of text is held at once
+    size_t chunks = (count + chunkSize - 1) / chunkSize;
+    size_t round = 4 * pool->size();
+    std::vector<BufferedWriter> texts(round);
+    for (size_t first = 0; first < chunks; first += round)
+    {
+      size_t last = std::min(chunks, first + round);
+      pool->parallelFor(last - first, [&](size_t c) {
+        size_t begin = (first + c) * chunkSize, end = std::min(count, begin + chunkSize);
+        texts[c].text.clear();
+        for (size_t i = begin; i < end; i++)
+          formatLine(i, texts[c]);
+      });
+      for (size_t c = 0; c < last - first; c++)
+        *this << texts[c];
+    }
+  }
+
+private:
+  BufferedWriter &commit()
+  {
+    if (out != nullptr && text.size() >= capacity)
+      flush();
+    return *this;
+  }
+
+private:
+  std::ostream *out;
+  size_t capacity;
+  std::string text;
+};
+
+#endif
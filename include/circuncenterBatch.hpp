@@ -0,0 +1,31 @@
+#ifndef CIRCUNCENTER_BATCH_H
+#define CIRCUNCENTER_BATCH_H
+
+#include <vector>
+#include <cstddef>
+
+/**
+ * Triangles stored as a structure of arrays, so their circuncenters can be computed several at a time.
+ *
+ * Triangle i has the vertices (x1[i], y1[i]), (x2[i], y2[i]) and (x3[i], y3[i]), and its circuncenter is written
+ * to (centerX[i], centerY[i]).
+ */
+struct CircuncenterBatch
+{
+  std::vector<double> x1, y1, x2, y2, x3, y3;
+  std::vector<double> centerX, centerY;
+
+  void resize(size_t n);
+  size_t size() const { return x1.size(); }
+
+  /**
+   * Compute the circuncenters of the triangles in [begin, end).
+   *
+   * The kernel uses AVX2 or SSE2 when the processor has them and plain code otherwise. Every kernel evaluates the
+   * same expression as geo::computeCircuncenter, in the same order and without fused operations, so the results
+   * are identical to it.
+   */
+  void compute(size_t begin, size_t end);
+};
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef COMPACT_DCEL_H
+#define COMPACT_DCEL_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+class Delaunay;
+class Voronoi;
+
+/**
+ * Index based DCEL, stored as a struct of arrays.
+ *
+ * Vertices, half-edges and faces are addressed by 32-bit indices and each field lives in its own array, so a
+ * traversal only touches the fields it reads. Half-edges are created in pairs: the twin of half-edge e is e ^ 1
+ * and its target is the origin of the twin.
+ *
+ * It is built from the pointer DCEL of a Delaunay or Voronoi instance. edgeOrder keeps the order in which the
+ * text writers number the half-edges, so the output of printDelaunay and printVoronoi can be reproduced from it.
+ */
+template <typename T>
+class CompactDcel
+{
+public:
+  static constexpr uint32_t none = UINT32_MAX;
+
+  uint32_t numVertices() const { return uint32_t(x.size()); }
+  uint32_t numHalfEdges() const { return uint32_t(origin.size()); }
+  uint32_t numFaces() const { return uint32_t(faceEdge.size()); }
+
+  uint32_t twin(uint32_t e) const { return e ^ 1; }
+  uint32_t target(uint32_t e) const { return origin[e ^ 1]; }
+
+  uint32_t addVertex(T vx, T vy, int id)
+  {
+    x.push_back(vx);
+    y.push_back(vy);
+    vertexId.push_back(id);
+    vertexEdge.push_back(none);
+    return numVertices() - 1;
+  }
+
+  /**
+   * Create the half-edge from -> to and its twin. Return the index of the first one.
+   */
+  uint32_t addEdge(uint32_t from, uint32_t to)
+  {
+    uint32_t e = numHalfEdges();
+    origin.push_back(from);
+    origin.push_back(to);
+    next.insert(next.end(), 2, none);
+    prev.insert(prev.end(), 2, none);
+    face.insert(face.end(), 2, none);
+    return e;
+  }
+
+  uint32_t addFace(uint32_t edge)
+  {
+    faceEdge.push_back(edge);
+    siteX.push_back(0);
+    siteY.push_back(0);
+    siteId.push_back(-1);
+    return numFaces() - 1;
+  }
+
+  void reserve(size_t vertices, size_t halfEdges, size_t faces)
+  {
+    x.reserve(vertices);
+    y.reserve(vertices);
+    vertexId.reserve(vertices);
+    vertexEdge.reserve(vertices);
+    origin.reserve(halfEdges);
+    next.reserve(halfEdges);
+    prev.reserve(halfEdges);
+    face.reserve(halfEdges);
+    edgeOrder.reserve(halfEdges);
+    faceEdge.reserve(faces);
+    siteX.reserve(faces);
+    siteY.reserve(faces);
+    siteId.reserve(faces);
+  }
+
+public:
+  // vertices
+  std::vector<T> x, y;
+  std::vector<int> vertexId;
+  std::vector<uint32_t> vertexEdge;
+
+  // half-edges
+  std::vector<uint32_t> origin, next, prev, face;
+  std::vector<uint32_t> edgeOrder;
+
+  // faces, with the site they belong to (siteId < 0 if none)
+  std::vector<uint32_t> faceEdge;
+  std::vector<int> siteX, siteY, siteId;
+};
+
+/**
+ * Snapshot of the triangulation: the vertices are the computation points, in order.
+ */
+CompactDcel<int> compactDelaunay(Delaunay const &del);
+
+/**
+ * Snapshot of the diagram: the vertices and faces keep the order of diagramVertices and diagramFaces.
+ */
+CompactDcel<double> compactVoronoi(Voronoi const &vor);
+
+#endif
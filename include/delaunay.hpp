@@ -2,53 +2,222 @@
 #define DELAUNAY_H
 
 #include <set>
+#include <algorithm>
+#include <array>
 #include <deque>
 #include <limits>
+#include <random>
 #include "point.hpp"
 #include "utils.hpp"
+#include "historyDag.hpp"
+#include "arena.hpp"
+#include "compactDcel.hpp"
+#include "stats.hpp"
+
+/**
+ * Construction options for the triangulation.
+ * 
+ * With spatialSort the sites are inserted in a biased randomized insertion order (BRIO), sorted along a Hilbert
+ * curve within each round, and located by walking from the last inserted triangle instead of using the history DAG.
+ * The seed makes the order and the walk reproducible.
+ * 
+ * The divide and conquer engine ignores both: it sorts the sites itself, triangulates chunks of them on a pool of
+ * [threads] threads (0 means one per hardware thread) and merges the chunks.
+ *
+ * The tiled engine is for very large inputs: it splits the bounding box in a grid of tiles x tiles (0 picks about
+ * 2^16 sites per tile), triangulates each tile with a halo of its neighbors on the pool, keeps the triangles whose
+ * circumcircle the tile can vouch for and stitches the rest along the seams. Only one tile is in memory per thread,
+ * besides the result. It builds the same triangulation as the divide and conquer engine, up to the split of
+ * cocircular sites, and falls back to it for inputs that fit a single tile.
+ */
+enum class DelaunayEngine
+{
+  incremental,
+  divideAndConquer,
+  tiled
+};
+
+struct DelaunayOptions
+{
+  bool spatialSort = false;
+  unsigned seed = 0;
+  DelaunayEngine engine = DelaunayEngine::incremental;
+  unsigned threads = 0;
+  int tiles = 0;
+};
+
+/**
+ * New position of a site, for Delaunay::moveSites.
+ */
+struct SiteMove
+{
+  PointInt *site;
+  int x, y;
+};
+
+/**
+ * What an insertion, a removal or a batch of moves changed in the triangulation, so a Voronoi diagram built from it
+ * can be repaired with Voronoi::update. An empty update (no sites) means nothing changed.
+ */
+struct DelaunayUpdate
+{
+  // Sites whose star changed: the inserted site and its neighbors, or the neighbors of the removed site
+  std::vector<PointInt *> sites;
+  // Faces holding a new triangle, and ids of the faces destroyed. A face may be in both, with a new id.
+  std::vector<Face<int> *> faces;
+  std::vector<int> removedFaces;
+
+  PointInt *insertedSite = nullptr;
+  // The removed site keeps its id, which is the index the last site was moved to
+  PointInt *removedSite = nullptr;
+
+  // Sites were moved, keeping their ids; sites holds them and every site whose star changed
+  bool moved = false;
+  // The triangulation had no triangle before or after the change and was built again from scratch
+  bool rebuilt = false;
+};
 
 class Delaunay
 {
 public:
-  Delaunay(std::vector<PointInt *> &p)
+  Delaunay() : useWalk(false), rng(0), lastFace(nullptr) {}
+  Delaunay(std::vector<PointInt *> &p, DelaunayOptions const &options = DelaunayOptions()) : useWalk(options.spatialSort), rng(options.seed), lastFace(nullptr)
   {
-    int maxX = std::numeric_limits<int>::min();
-    int minX = std::numeric_limits<int>::max();
-    int maxY = std::numeric_limits<int>::min();
-    int minY = std::numeric_limits<int>::max();
-
-    for (auto &point : p)
-    {
-      maxX = point->x > maxX ? point->x : maxX;
-      minX = point->x < minX ? point->x : minX;
-
-      maxY = point->y > maxY ? point->y : maxY;
-      minY = point->y < minY ? point->x : minY;
-      points.push_back(point);
-    }
-    prepareTriangulation(minX, maxX, minY, maxY);
-    triangulate();
+    build(p, options);
   }
 
-  friend void printDelaunay(Delaunay const &del);
+  /**
+  * Triangulate other sites in place of the current ones, as if constructed again, but keeping the memory of the
+  * arenas for the new DCEL. References to the old sites, half-edges and faces are dropped.
+  */
+  void reset(std::vector<PointInt *> &p, DelaunayOptions const &options = DelaunayOptions());
+
+  /**
+  * Bounds of the ids of the half-edges and faces, so they can index flat tables. After the construction the ids
+  * are 0 to numHalfEdges() - 1 and 0 to faces.size() - 1; insert and remove recycle the ids of the elements they
+  * destroy. Sites are numbered from 1, in input order, and inserted sites are appended.
+  */
+  size_t numHalfEdges() const { return halfEdgeCount; }
+  size_t numFaceIds() const { return faceCount; }
+
+  /**
+  * Insert a site, owned by the caller, splitting the triangle that contains it (or connecting it to the hull
+  * edges it sees) and legalizing the edges around it. The cost depends on the size of its star, not on the
+  * number of sites. A site already in the triangulation is not inserted.
+  */
+  DelaunayUpdate insert(PointInt *site);
+
+  /**
+  * Remove a site and triangulate the hole it leaves with Delaunay ears. The last site takes its place in points
+  * and its id.
+  */
+  DelaunayUpdate remove(PointInt *site);
+
+  /**
+  * Move sites to new positions, keeping their ids, and repair the triangulation. A small move is repaired by flips
+  * around the site; a site that leaves the polygon of its neighbors, or is on the hull, is removed and inserted
+  * again. The cost depends on the number of flips and relocations, not on the number of sites. A site whose new
+  * position is still taken by another site once the others have moved stays where it was.
+  */
+  DelaunayUpdate moveSites(std::vector<SiteMove> const &moves);
+
+  /**
+  * Id of the site nearest to each query point (one of them on a tie), found by walking the triangulation from
+  * the answer to a nearby query. The batch is split on [threads] threads (0 means one per hardware thread), which
+  * only read the triangulation. The answers are 0 if there are no sites.
+  */
+  std::vector<int> nearestSites(std::vector<PointDouble> const &queries, unsigned threads = 0) const;
+
+  friend void printDelaunay(Delaunay const &del, unsigned threads);
+  friend CompactDcel<int> compactDelaunay(Delaunay const &del);
 
 private:
+  void build(std::vector<PointInt *> &p, DelaunayOptions const &options);
   void triangulate();
 
+  /**
+  * Guibas-Stolfi divide and conquer triangulation. Produces the same DCEL as triangulate().
+  */
+  void divideAndConquer(unsigned threads);
+
+  /**
+  * Tiled construction on top of the divide and conquer engine, see DelaunayEngine::tiled.
+  */
+  void tiledDivideAndConquer(unsigned threads, int tiles);
+
+  /**
+  * Build the DCEL from clockwise triangles given as indices of sites, which must be every site once. Return false,
+  * leaving the triangulation untouched, if they do not form a triangulated polygon.
+  */
+  bool buildFromTriangles(std::vector<PointInt *> const &sites, std::vector<std::array<int, 3>> const &triangles);
+
   // auxiliary methods
   void prepareTriangulation(int minX, int maxX, int minY, int maxY);
+  void sortPoints();
   Face<int> *findTriangle(PointInt *p, HalfEdge<int> **onEdge);
+  Face<int> *walkToTriangle(PointInt *p, Face<int> *start, HalfEdge<int> **exit = nullptr);
 
   /**
-  * Remove vertex and rearrange DCEL around it.
+  * Site nearest to the query: walk from the triangle of edge to the query, leaving edge on the triangle (or hull
+  * edge) where the walk stopped, then move to closer neighbors while there is one.
+  */
+  PointInt *nearestSite(PointDouble const &query, HalfEdge<int> *&edge) const;
+
+  /**
+  * Remove vertex and rearrange DCEL around it, merging its triangles into one face (or into the outer face if it
+  * is on the hull). The point itself is left to its owner.
   */
   void removeVertex(PointInt *p);
 
+  /**
+  * Give dense ids to the faces and half-edges of the finished triangulation.
+  */
+  void numberElements();
+  int newFaceId();
+  int newHalfEdgeId();
+
+  /**
+  * Triangulate the hole left by a removed vertex. chain holds the half-edges around it, each one followed by the
+  * next; an open chain runs along the hull and is clipped until it is convex. Return the new triangles.
+  */
+  std::vector<Face<int> *> fillHole(std::vector<HalfEdge<int> *> chain, bool closed, std::vector<HalfEdge<int> *> &newEdges);
+
+  /**
+  * Lawson flips: flip the illegal edges among the pending ones, and check the sides of each flipped
+  * quadrilateral in turn, until every edge is legal. The triangulation must have no inverted triangle. The
+  * vertices and face ids of each flipped quadrilateral are added to change.
+  */
+  void flipToDelaunay(std::vector<HalfEdge<int> *> &pending, DelaunayUpdate &change);
+
+  /**
+  * Move one site for moveSites, adding the sites and the ids of the faces it touches to change. Return false,
+  * leaving the site where it was, if another site is at (x, y).
+  */
+  bool moveSite(PointInt *site, int x, int y, DelaunayUpdate &change);
+
+  /**
+  * Build the triangulation again with the divide and conquer engine, for the degenerate cases that insert and
+  * remove do not handle (no triangle before or after the change).
+  */
+  void rebuild();
+
 public:
   pointIntVector points;
   std::set<Face<int> *> faces;
 
 private:
+  // Owns the bounding vertices, half-edges and faces. The sites belong to the caller.
+  DcelArena<int> arena;
+  // Half-edges of the divide and conquer engine, one arena per chunk so chunks can be built concurrently.
+  std::deque<Arena<HalfEdge<int>>> chunkArenas;
+
   std::deque<PointInt *> computationPoints;
+  HistoryDag<int> history;
+  bool useWalk;
+  std::mt19937 rng;
+  Face<int> *lastFace;
+  size_t halfEdgeCount = 0;
+  size_t faceCount = 0;
+  std::vector<int> freeHalfEdgeIds, freeFaceIds;
 };
 #endif
\ No newline at end of file
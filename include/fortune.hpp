@@ -0,0 +1,134 @@
+#ifndef FORTUNE_H
+#define FORTUNE_H
+
+#include <vector>
+#include <set>
+#include <deque>
+#include <queue>
+#include "point.hpp"
+
+/**
+ * Planar graph of a Voronoi diagram clipped to a box, before it is turned into a DCEL.
+ *
+ * It holds the clipped Voronoi edges and the pieces of the box between them. Vertices on the box have exactly
+ * the coordinates of its sides. Voronoi edges keep the index of the two sites they separate, box edges have
+ * both sites set to -1.
+ */
+struct VoronoiGraph
+{
+  struct Edge
+  {
+    int from, to;
+    int site1, site2;
+  };
+
+  std::vector<PointDouble> vertices;
+  std::vector<Edge> edges;
+};
+
+/**
+ * Fortune's sweepline algorithm.
+ *
+ * The sweep line moves downwards. The beach line is a balanced tree of breakpoints, ordered by their position on
+ * the current sweep line, and circle events wait in a priority queue. Repeated sites are ignored.
+ *
+ * The diagram of the given sites, clipped to the box, is left in graph.
+ */
+class Fortune
+{
+public:
+  Fortune(std::vector<PointInt *> const &sites, double minX, double maxX, double minY, double maxY);
+
+public:
+  VoronoiGraph graph;
+
+private:
+  struct CircleEvent;
+  struct Breakpoint;
+
+  struct BreakpointComparison
+  {
+    typedef void is_transparent;
+    Fortune const *owner;
+
+    bool operator()(Breakpoint const *a, Breakpoint const *b) const;
+    bool operator()(Breakpoint const *a, double x) const;
+    bool operator()(double x, Breakpoint const *b) const;
+  };
+
+  typedef std::set<Breakpoint *, BreakpointComparison> BeachLine;
+
+  /**
+   * Intersection of the arcs of sites left and right. It traces one end of a Voronoi edge.
+   */
+  struct Breakpoint
+  {
+    int left, right;
+    int edge, end;
+
+    // circle event of the arc at the right of the breakpoint
+    CircleEvent *event;
+    BeachLine::iterator position;
+  };
+
+  struct CircleEvent
+  {
+    double y;
+    PointDouble center;
+    Breakpoint *left;
+    bool valid;
+  };
+
+  struct CircleEventComparison
+  {
+    bool operator()(CircleEvent const *a, CircleEvent const *b) const
+    {
+      return a->y != b->y ? a->y < b->y : a->center.x > b->center.x;
+    }
+  };
+
+  /**
+   * Voronoi edge between two sites. Each end is either a vertex or, while it is not known, the direction the
+   * breakpoint tracing it moves along.
+   */
+  struct TracedEdge
+  {
+    int site1, site2;
+    int vertex[2];
+    PointDouble direction[2];
+  };
+
+private:
+  void handleSite(int site);
+  void handleCircle(CircleEvent *event);
+
+  double breakpointX(Breakpoint const *bp, double sweep) const;
+  Breakpoint *createBreakpoint(int left, int right, int edge, int end, BeachLine::iterator hint);
+  int createEdge(int site1, int site2);
+  void checkCircle(Breakpoint *left);
+  void discardCircle(Breakpoint *left);
+
+  /**
+   * Clip the traced edges to the box, close the box around them and fill graph.
+   *
+   * If there is only one site, it is given as loneSite and owns the whole box.
+   */
+  void buildGraph(int loneSite);
+
+private:
+  std::vector<PointInt *> const &sites;
+  double minX, maxX, minY, maxY;
+  double tolerance;
+
+  double sweepY;
+  BeachLine beachLine;
+  int loneArc;
+  std::priority_queue<CircleEvent *, std::vector<CircleEvent *>, CircleEventComparison> circleEvents;
+
+  std::deque<Breakpoint> breakpoints;
+  std::deque<CircleEvent> events;
+  std::vector<TracedEdge> edges;
+  std::vector<PointDouble> vertices;
+};
+
+#endif
@@ -2,6 +2,8 @@
 #define GEOMETRIC_FUNC_H
 
 #include "delaunay.hpp"
+#include "arena.hpp"
+#include "predicates.hpp"
 
 namespace geo
 {
@@ -21,9 +23,11 @@ namespace geo
  * Create an edge, from a point to ("2") another point.
  * 
  * Used at the initialization of the bounding triange
+ * 
+ * Every function that creates DCEL elements allocates them from the given arena.
  */
   template <typename T>
-  HalfEdge<T> *createEdgeP2P(Point<T> *from, Point<T> *to, Face<T> *leftFace, Face<T> *rightFace);
+  HalfEdge<T> *createEdgeP2P(DcelArena<T> &arena, Point<T> *from, Point<T> *to, Face<T> *leftFace, Face<T> *rightFace);
 
   /**
  *  Create an edge, from a point to ("2") a half-edge.
@@ -32,7 +36,7 @@ namespace geo
  * 
  */
   template <typename T>
-  HalfEdge<T> *createEdgeP2E(Point<T> *from, HalfEdge<T> *toEdge);
+  HalfEdge<T> *createEdgeP2E(DcelArena<T> &arena, Point<T> *from, HalfEdge<T> *toEdge);
 
   /**
  * Set the face reference in each node of the edge chain. 
@@ -41,7 +45,7 @@ namespace geo
   void setFace(HalfEdge<T> *edgeChain, Face<T> *face);
 
   template <typename T>
-  void insertPointInEdge(Point<T> *p, HalfEdge<T> *edge);
+  void insertPointInEdge(DcelArena<T> &arena, Point<T> *p, HalfEdge<T> *edge);
 
   /**
  * Insert diagonal and set faces.
@@ -49,13 +53,26 @@ namespace geo
  * Return the face created.
  */
   template <typename T>
-  Face<T> *insertDiagonal(HalfEdge<T> *fromEdge, HalfEdge<T> *toEdge);
+  Face<T> *insertDiagonal(DcelArena<T> &arena, HalfEdge<T> *fromEdge, HalfEdge<T> *toEdge);
   
   template <typename T>
-  Face<T> *insertDiagonal(HalfEdge<T> *fromEdge, HalfEdge<T> *toEdge, HalfEdge<T> **newEdge, bool computeFace);
+  Face<T> *insertDiagonal(DcelArena<T> &arena, HalfEdge<T> *fromEdge, HalfEdge<T> *toEdge, HalfEdge<T> **newEdge, bool computeFace);
 
+  /**
+ * Replace the edge between two triangles with the other diagonal of their quadrilateral, which must be convex.
+ * 
+ * The half-edges and faces are reused, so their ids do not change.
+ */
+  template <typename T>
+  void flipEdge(HalfEdge<T> *edge);
+
+  /**
+ * Flip the edge if it is illegal and recursively legalize the edges that were exposed.
+ * 
+ * If a history DAG is given, the flipped triangles are registered in it.
+ */
   template <typename T>
-  void legalizeEdge(Point<T> *p, HalfEdge<T> *edge);
+  void legalizeEdge(Point<T> *p, HalfEdge<T> *edge, HistoryDag<T> *history = nullptr);
 
   /**
  * Remove vertex and rearrange DCEL around it.
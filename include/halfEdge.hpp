@@ -62,4 +62,44 @@ private:
   int id;
 };
 
+/**
+ * Range over the half-edges leaving a vertex.
+ * 
+ * The star is walked by rotation, so it must not be modified while it is iterated.
+ */
+template <typename T>
+class VertexStar
+{
+public:
+  class iterator
+  {
+  public:
+    iterator(HalfEdge<T> *start, bool done) : start(start), current(start), done(done) {}
+
+    HalfEdge<T> *operator*() const { return current; }
+
+    iterator &operator++()
+    {
+      current = current->twin()->next();
+      done = current == start;
+      return *this;
+    }
+
+    bool operator==(iterator const &it) const { return current == it.current && done == it.done; }
+    bool operator!=(iterator const &it) const { return !(*this == it); }
+
+  private:
+    HalfEdge<T> *start, *current;
+    bool done;
+  };
+
+  VertexStar(HalfEdge<T> *start) : start(start) {}
+
+  iterator begin() const { return iterator(start, start == nullptr); }
+  iterator end() const { return iterator(start, true); }
+
+private:
+  HalfEdge<T> *start;
+};
+
 #endif
\ No newline at end of file
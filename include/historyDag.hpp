@@ -0,0 +1,144 @@
+#ifndef HISTORY_DAG_H
+#define HISTORY_DAG_H
+
+#include <deque>
+#include <unordered_map>
+#include <initializer_list>
+#include "point.hpp"
+#include "halfEdge.hpp"
+#include "face.hpp"
+#include "predicates.hpp"
+#include "stats.hpp"
+
+/**
+ * Node of the history DAG.
+ *
+ * It stores the triangle as it was when the node was created. Leaves point to the live face,
+ * inner nodes point to the triangles that replaced them (at most 3, when a triangle is split).
+ */
+template <typename T>
+struct HistoryNode
+{
+  Point<T> *p1, *p2, *p3;
+  Face<T> *face;
+  HistoryNode<T> *children[3];
+  int numChildren;
+};
+
+/**
+ * Point location structure of Guibas, Knuth and Sharir.
+ *
+ * Every triangle destroyed by a split or a flip keeps pointing to the triangles that replaced it,
+ * so locating a point is a descent from the bounding triangle down to a leaf.
+ *
+ * A DAG that was never reset is disabled: it ignores updates and doesn't locate anything.
+ */
+template <typename T>
+class HistoryDag
+{
+public:
+  HistoryDag() : root(nullptr) {}
+
+  /**
+   * Discard the history and start a new one from the bounding triangle.
+   */
+  void reset(Face<T> *face)
+  {
+    clear();
+    root = createLeaf(face);
+  }
+
+  void clear()
+  {
+    root = nullptr;
+    nodes.clear();
+    leaves.clear();
+  }
+
+  /**
+   * Leaf that currently represents the face.
+   *
+   * Must be fetched before the face is modified, since faces are reused by splits and flips.
+   */
+  HistoryNode<T> *leaf(Face<T> *face) const
+  {
+    auto it = leaves.find(face);
+    return it != leaves.end() ? it->second : nullptr;
+  }
+
+  /**
+   * Register the faces that replaced the triangles of the given leaves.
+   */
+  void replace(std::initializer_list<HistoryNode<T> *> parents, std::initializer_list<Face<T> *> created)
+  {
+    if (root == nullptr)
+      return;
+
+    for (auto const &parent : parents)
+    {
+      parent->face = nullptr;
+      parent->numChildren = 0;
+    }
+    for (auto const &f : created)
+    {
+      auto node = createLeaf(f);
+      for (auto const &parent : parents)
+        parent->children[parent->numChildren++] = node;
+    }
+  }
+
+  /**
+   * Descend the DAG and return the face that contains the point, or nullptr if it is outside the bounding triangle.
+   */
+  Face<T> *locate(Point<T> const &p) const
+  {
+    HistoryNode<T> *node = root;
+    if (node == nullptr || !contains(node, p))
+      return nullptr;
+
+    while (node->numChildren > 0)
+    {
+      HistoryNode<T> *next = nullptr;
+      for (int i = 0; i < node->numChildren && next == nullptr; i++)
+      {
+        STATS_ADD(scan, 1);
+        if (contains(node->children[i], p))
+          next = node->children[i];
+      }
+      if (next == nullptr)
+        return nullptr;
+      node = next;
+    }
+    return node->face;
+  }
+
+private:
+  HistoryNode<T> *createLeaf(Face<T> *face)
+  {
+    auto e = face->edgeChain();
+    nodes.push_back({e->from(), e->to(), e->prev()->from(), face, {nullptr, nullptr, nullptr}, 0});
+    leaves[face] = &nodes.back();
+    return &nodes.back();
+  }
+
+  /**
+   * Check if the point is inside the triangle or on its boundary, regardless of its orientation.
+   */
+  static bool contains(HistoryNode<T> const *node, Point<T> const &p)
+  {
+    int o1 = geo::orient2d(*node->p1, *node->p2, p);
+    int o2 = geo::orient2d(*node->p2, *node->p3, p);
+    int o3 = geo::orient2d(*node->p3, *node->p1, p);
+
+    bool hasNegative = o1 < 0 || o2 < 0 || o3 < 0;
+    bool hasPositive = o1 > 0 || o2 > 0 || o3 > 0;
+    return !(hasNegative && hasPositive);
+  }
+
+private:
+  HistoryNode<T> *root;
+  std::deque<HistoryNode<T>> nodes;
+  std::unordered_map<Face<T> *, HistoryNode<T> *> leaves;
+};
+
+#endif
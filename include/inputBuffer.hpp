@@ -0,0 +1,33 @@
+#ifndef INPUT_BUFFER_H
+#define INPUT_BUFFER_H
+
+#include <vector>
+#include <cstddef>
+
+/**
+ * Contents of the standard input: mapped when it is a regular file, read in large blocks otherwise.
+ */
+class InputBuffer
+{
+public:
+  InputBuffer();
+  ~InputBuffer();
+
+  InputBuffer(InputBuffer const &) = delete;
+  InputBuffer &operator=(InputBuffer const &) = delete;
+
+  char const *begin() const { return mapped != nullptr ? mapped : buffer.data(); }
+  char const *end() const { return begin() + length; }
+
+private:
+  char const *mapped;
+  size_t length;
+  std::vector<char> buffer;
+};
+
+inline bool isBlank(char c)
+{
+  return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+#endif
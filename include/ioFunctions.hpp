@@ -2,16 +2,89 @@
 #define IO_FUNCTIONS_H
 
 #include <vector>
+#include <deque>
+#include <string>
 #include "point.hpp"
 #include "delaunay.hpp"
 #include "voronoi.hpp"
+#include "compactDcel.hpp"
+#include "binaryDcel.hpp"
+#include "bufferedWriter.hpp"
 
-void readPoints(std::vector<PointInt *> &sites);
+/**
+ * Read the number of sites and their integer coordinates from the standard input into storage, numbered from 1,
+ * and point sites at them. The input is mapped when it is a file, and large inputs are parsed on [threads]
+ * threads (0 means one per hardware thread).
+ *
+ * Exit with an error if the input has fewer sites than announced or anything that is not an integer.
+ */
+void readPoints(std::vector<PointInt> &storage, std::vector<PointInt *> &sites, unsigned threads = 0);
 
-void printDelaunay(Delaunay const &del);
+/**
+ * Parse one site set in the input format from [begin, end), like readPoints but on a single thread and without
+ * exiting: return an empty string, or the reason the set is invalid.
+ */
+std::string parseSites(char const *begin, char const *end, std::vector<PointInt> &storage, std::vector<PointInt *> &sites);
+
+/**
+ * Apply the updates listed in a file, one per line: "+ x y" inserts a site, kept in storage, and "- x y" removes
+ * the site at (x, y). The diagram is repaired after each one.
+ *
+ * Exit with an error on a malformed line or the removal of a site that is not there.
+ */
+void applyUpdates(char const *path, Delaunay &del, Voronoi &vor, std::deque<PointInt> &storage);
+
+/**
+ * Read the next frame of a file of moving sites: the number of sites, then the position of each one in the order
+ * of their ids, like the input. Fill moves with the sites whose position changed; return false at the end of the
+ * file.
+ *
+ * Exit with an error if the frame is malformed or does not have one position per site.
+ */
+bool readFrame(std::istream &in, Delaunay const &del, std::vector<SiteMove> &moves);
+
+/**
+ * Read query points from a file: their number, then their coordinates, which may be fractional.
+ *
+ * Exit with an error if the file can not be read or is malformed.
+ */
+void readQueries(char const *path, std::vector<PointDouble> &queries);
+
+/**
+ * Print one site id per line.
+ */
+void printSiteIds(std::vector<int> const &ids, unsigned threads = 1);
+
+/**
+ * Print the triangulation and the diagram as text. Large outputs are formatted on [threads] threads (0 means one
+ * per hardware thread).
+ */
+void printDelaunay(Delaunay const &del, unsigned threads = 1);
+
+/**
+ * Format the triangulation like printDelaunay into out, with the pool if there is one.
+ */
+void writeDelaunay(Delaunay const &del, BufferedWriter &out, ThreadPool *pool = nullptr);
 
 void delaunayDebug(Delaunay const &del);
 
-void printVoronoi(Voronoi const &vor);
+void printVoronoi(Voronoi const &vor, unsigned threads = 1);
+
+/**
+ * Format the diagram like printVoronoi into out, with the pool if there is one.
+ */
+void writeVoronoi(Voronoi const &vor, BufferedWriter &out, ThreadPool *pool = nullptr);
+
+/**
+ * Adapters for the compact DCEL, with the same output as the pointer versions.
+ */
+void printDelaunay(CompactDcel<int> const &dcel, unsigned threads = 1);
+
+void printVoronoi(CompactDcel<double> const &dcel, unsigned threads = 1);
+
+/**
+ * Text output of a diagram read from the binary layout, the same as printVoronoi of the diagram it was written from.
+ */
+void printVoronoi(BinaryDcel const &dcel, unsigned threads = 1);
 
 #endif
\ No newline at end of file
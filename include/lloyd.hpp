@@ -0,0 +1,40 @@
+#ifndef LLOYD_H
+#define LLOYD_H
+
+#include "delaunay.hpp"
+
+/**
+ * Options of the Lloyd relaxation. It stops after maxIterations, or as soon as no site is farther than tolerance
+ * from the centroid of its cell.
+ */
+struct RelaxationOptions
+{
+  int maxIterations = 0;
+  double tolerance = 0.5;
+  unsigned threads = 0;
+};
+
+struct RelaxationResult
+{
+  int iterations = 0;
+  // distance from the farthest site to the centroid of its cell, at the last iteration
+  double maxDisplacement = 0;
+  bool converged = false;
+};
+
+/**
+ * Lloyd relaxation towards a centroidal Voronoi diagram. Each iteration:
+ *
+ * 1. Compute the circumcenters of the triangles, which are the vertices of the Voronoi cells
+ * 2. Clip the cell of each site to the box of the diagram (the bounding box of the sites before the relaxation,
+ *    grown by 5 like in Voronoi::prepareVoronoi) and compute its area and centroid
+ * 3. Move each site to its centroid, rounded to integers, with Delaunay::moveSites
+ *
+ * Steps 1 and 2 run on [threads] threads (0 means one per hardware thread). The triangulation is kept from one
+ * iteration to the next and repaired by moveSites, mostly with a few flips, so the diagram only has to be built once
+ * the sites settle. Sites that would land on another site stay where they are, and the relaxation stops early when
+ * the rounding keeps every site in place.
+ */
+RelaxationResult relaxSites(Delaunay &del, RelaxationOptions const &options);
+
+#endif
@@ -1,11 +1,12 @@
 #ifndef POINT_H
 #define POINT_H
 
-#include <set>
-
 template <typename T>
 class HalfEdge;
 
+template <typename T>
+class VertexStar;
+
 /**
  * This class represents of a point.
 */
@@ -13,11 +14,11 @@ template <typename T>
 class Point
 {
 public:
-  Point() : x(0), y(0), id(-1) {}
+  Point() : x(0), y(0), e(nullptr), id(-1) {}
 
-  Point(T a1, T a2) : x(a1), y(a2), id(-1) {}
+  Point(T a1, T a2) : x(a1), y(a2), e(nullptr), id(-1) {}
 
-  Point(T a1, T a2, int idx) : x(a1), y(a2), id(idx) {}
+  Point(T a1, T a2, int idx) : x(a1), y(a2), e(nullptr), id(idx) {}
 
   // Casting
   template <typename U>
@@ -31,18 +32,17 @@ public:
 
   void setId(int i) { id = i; }
 
-  void insertIncidentEdge(HalfEdge<T> *e)
-  {
-    incidentEdges.insert(e);
-  }
-  void removeIncidentEdge(HalfEdge<T> *e)
-  {
-    auto tmp = incidentEdges.find(e);
-    if (tmp != incidentEdges.end())
-    {
-      incidentEdges.erase(tmp);
-    }
-  }
+  /**
+   * One of the half-edges leaving the point, or nullptr if it is isolated.
+   */
+  HalfEdge<T> *outgoingEdge() const { return e; }
+
+  void setOutgoingEdge(HalfEdge<T> *edge) { e = edge; }
+
+  /**
+   * Every half-edge leaving the point, enumerated by rotation (twin()->next()) from the outgoing edge.
+   */
+  VertexStar<T> outgoingEdges() const { return VertexStar<T>(e); }
 
   Point<T> operator+(const Point<T> &p)
   {
@@ -100,9 +100,9 @@ public:
 
 public:
   T x, y;
-  std::set<HalfEdge<T> *> incidentEdges;
 
 private:
+  HalfEdge<T> *e;
   int id;
 };
 
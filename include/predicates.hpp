@@ -0,0 +1,70 @@
+#ifndef PREDICATES_H
+#define PREDICATES_H
+
+#include "point.hpp"
+
+namespace geo
+{
+  /**
+ * Sign of the orientation of (a, b, c): 1 if they turn counterclockwise, -1 if clockwise, 0 if colinear.
+ */
+  template <typename T>
+  int orient2d(Point<T> const &a, Point<T> const &b, Point<T> const &c)
+  {
+    double det = (double(b.x) - a.x) * (double(c.y) - a.y) - (double(b.y) - a.y) * (double(c.x) - a.x);
+    return (det > 0) - (det < 0);
+  }
+
+  /**
+ * Sign of the incircle determinant: 1 if d is inside the circle through a, b and c, -1 if outside, 0 if they are cocircular.
+ *
+ * a, b and c must be in counterclockwise order, otherwise the sign is reversed.
+ */
+  template <typename T>
+  int incircle(Point<T> const &a, Point<T> const &b, Point<T> const &c, Point<T> const &d)
+  {
+    double adx = double(a.x) - d.x, ady = double(a.y) - d.y;
+    double bdx = double(b.x) - d.x, bdy = double(b.y) - d.y;
+    double cdx = double(c.x) - d.x, cdy = double(c.y) - d.y;
+
+    double det = (adx * adx + ady * ady) * (bdx * cdy - cdx * bdy) +
+                 (bdx * bdx + bdy * bdy) * (cdx * ady - adx * cdy) +
+                 (cdx * cdx + cdy * cdy) * (adx * bdy - bdx * ady);
+    return (det > 0) - (det < 0);
+  }
+
+  /**
+ * Exact version for integer points. The differences fit in 33 bits, so both determinants are computed
+ * without rounding in 128-bit arithmetic for every coordinate an int can hold.
+ */
+  template <>
+  inline int orient2d<int>(Point<int> const &a, Point<int> const &b, Point<int> const &c)
+  {
+    __int128 det = __int128((long long)b.x - a.x) * ((long long)c.y - a.y) -
+                   __int128((long long)b.y - a.y) * ((long long)c.x - a.x);
+    return (det > 0) - (det < 0);
+  }
+
+  /**
+ * Exact version for integer points. The lifted terms need about 4 times the bits of a coordinate difference,
+ * so it is exact while the coordinates (including the bounding triangle) stay within 2^30 of each other.
+ */
+  template <>
+  inline int incircle<int>(Point<int> const &a, Point<int> const &b, Point<int> const &c, Point<int> const &d)
+  {
+    long long adx = (long long)a.x - d.x, ady = (long long)a.y - d.y;
+    long long bdx = (long long)b.x - d.x, bdy = (long long)b.y - d.y;
+    long long cdx = (long long)c.x - d.x, cdy = (long long)c.y - d.y;
+
+    __int128 alift = __int128(adx) * adx + __int128(ady) * ady;
+    __int128 blift = __int128(bdx) * bdx + __int128(bdy) * bdy;
+    __int128 clift = __int128(cdx) * cdx + __int128(cdy) * cdy;
+
+    __int128 det = alift * (__int128(bdx) * cdy - __int128(cdx) * bdy) +
+                   blift * (__int128(cdx) * ady - __int128(adx) * cdy) +
+                   clift * (__int128(adx) * bdy - __int128(bdx) * ady);
+    return (det > 0) - (det < 0);
+  }
+}
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <cstddef>
+#include "delaunay.hpp"
+
+/*
+ * Server mode: a long-running process that answers site sets over a Unix domain socket, or over its standard
+ * input and output, so the cost of starting the program and warming its memory is paid once.
+ *
+ * The protocol is a sequence of framed messages. A request is a line "<command> <length>" followed by length bytes:
+ *
+ *   voronoi <length>    the body is a site set in the input format; the answer is its diagram, like printVoronoi
+ *   delaunay <length>   the same, answered with the triangulation, like printDelaunay
+ *   stats 0             the answer is the metrics of the server so far, as JSON
+ *   shutdown 0          the server stops accepting connections and exits once the open ones are done
+ *
+ * Each answer is a line "ok <length> <microseconds>" or "error <length> <microseconds>" followed by length bytes
+ * of output or of the reason of the error, microseconds being the time the server spent on the request. A request
+ * over the size limit is answered with an error and its connection is closed, since its body is not read.
+ */
+
+struct ServerOptions
+{
+  DelaunayOptions triangulation;
+  // largest body accepted, in bytes
+  size_t maxRequestBytes = size_t(1) << 26;
+  // sites of the synthetic set each worker triangulates before the first connection, to grow its arenas
+  int warmupSites = 1 << 12;
+};
+
+/**
+ * Listen on the socket at path, which is replaced if it exists, and serve connections until a shutdown request.
+ * Connections are served by a fixed pool of [triangulation.threads] workers (0 means one per hardware thread),
+ * one connection at a time each, with the requests of a connection answered in order. Each worker keeps its
+ * triangulation and diagram warm from one request to the next. The metrics are written to the standard error at
+ * exit.
+ *
+ * Exit with an error if the socket can not be created.
+ */
+void serveSocket(char const *path, ServerOptions const &options);
+
+/**
+ * Serve the requests read from the standard input, answering on the standard output, until the input ends or a
+ * shutdown request.
+ */
+void serveStandardStreams(ServerOptions const &options);
+
+/**
+ * Send one request to the server at path, with the standard input as the body unless the command is stats or
+ * shutdown, and print the answer. Return false, after reporting it on the standard error, if the answer is an
+ * error.
+ *
+ * Exit with an error if the server can not be reached.
+ */
+bool requestServer(char const *path, char const *command);
+
+#endif
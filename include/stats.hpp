@@ -0,0 +1,86 @@
+#ifndef STATS_H
+#define STATS_H
+
+/**
+ * Instrumentation of a run: counters on the hot paths of the construction and timers of its phases, reported as
+ * JSON by --stats.
+ *
+ * It is only compiled in when VORONOI_STATS is defined (make STATS=1). Otherwise the macros below expand to
+ * nothing and the build is the same as without them. The counters are plain integers, so they must only be
+ * updated by the thread that builds the triangulation and the diagram, never from inside a parallel loop.
+ */
+#ifdef VORONOI_STATS
+
+#include <chrono>
+#include <ostream>
+
+enum class Phase
+{
+  parse,
+  triangulate,
+  removeBoundingTriangle,
+  circuncenters,
+  edgeBuild,
+  output,
+  count
+};
+
+struct Stats
+{
+  // faces tested to locate each point, by the history DAG or the walk; scan counts the current location
+  unsigned long long findTriangleCalls = 0, facesScanned = 0, maxFacesScanned = 0, scan = 0;
+  // flips done by legalizeEdge, and the nesting of its recursion
+  unsigned long long flips = 0, legalizeDepth = 0, maxLegalizeDepth = 0;
+  unsigned long long boundingVertexRemovals = 0;
+  unsigned long long mergedCircuncenters = 0;
+  // lookups in the index of a side of the box, and the segments walked back from where the lookup landed
+  unsigned long long boundingSegmentSearches = 0, boundingSegmentSteps = 0;
+
+  double phaseMs[int(Phase::count)] = {};
+  std::chrono::steady_clock::time_point phaseStart[int(Phase::count)];
+
+  void start(Phase phase) { phaseStart[int(phase)] = std::chrono::steady_clock::now(); }
+  void stop(Phase phase)
+  {
+    phaseMs[int(phase)] += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - phaseStart[int(phase)]).count();
+  }
+
+  void endFindTriangle()
+  {
+    findTriangleCalls++;
+    facesScanned += scan;
+    maxFacesScanned = scan > maxFacesScanned ? scan : maxFacesScanned;
+    scan = 0;
+  }
+
+  void enterFlip()
+  {
+    flips++;
+    legalizeDepth++;
+    maxLegalizeDepth = legalizeDepth > maxLegalizeDepth ? legalizeDepth : maxLegalizeDepth;
+  }
+  void leaveFlip() { legalizeDepth--; }
+};
+
+extern Stats stats;
+
+/**
+ * Write the counters and the phase times as a JSON object.
+ */
+void writeStats(std::ostream &out);
+
+#define STATS_ONLY(...) __VA_ARGS__
+#define STATS_ADD(counter, n) (stats.counter += (n))
+#define STATS_START(phase) stats.start(Phase::phase)
+#define STATS_STOP(phase) stats.stop(Phase::phase)
+
+#else
+
+#define STATS_ONLY(...)
+#define STATS_ADD(counter, n) ((void)0)
+#define STATS_START(phase) ((void)0)
+#define STATS_STOP(phase) ((void)0)
+
+#endif
+
+#endif
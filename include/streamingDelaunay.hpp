@@ -0,0 +1,139 @@
+#ifndef STREAMING_DELAUNAY_H
+#define STREAMING_DELAUNAY_H
+
+#include <vector>
+#include <unordered_map>
+#include <cstddef>
+#include "point.hpp"
+#include "bufferedWriter.hpp"
+
+/**
+ * Uniform grid over the bounding box of a streamed point set. Cells are numbered row by row from the bottom left.
+ */
+struct StreamGrid
+{
+  int cols, rows;
+  int minX, minY, maxX, maxY;
+
+  int numCells() const { return cols * rows; }
+  int column(double x) const;
+  int row(double y) const;
+  int cellOf(int x, int y) const { return row(y) * cols + column(x); }
+  bool contains(int x, int y) const { return x >= minX && x <= maxX && y >= minY && y <= maxY; }
+};
+
+/**
+ * Streaming Delaunay triangulation, in the style of Isenburg et al., "Streaming computation of Delaunay
+ * triangulations".
+ *
+ * The sites come in a stream interleaved with finalization tags: once a cell of the grid is finalized, no more
+ * sites will fall in it. A triangle whose circumcircle only covers finalized cells (or lies outside the grid) can
+ * not be changed by later sites, so it is written out and its memory reused. A vertex is released with its last
+ * triangle. Memory is bounded by the triangles around the cells still open, not by the number of sites.
+ *
+ * Sites are inserted by Bowyer-Watson with ghost triangles (triangles with a vertex at infinity) along the
+ * convex hull, so the hull is exact. The output is a streaming mesh: "v id x y" before the first triangle that
+ * uses a vertex, and "t id1 id2 id3" for each triangle, clockwise like the faces of the DCEL. Sites are numbered
+ * from 1 in stream order; repeated sites are skipped.
+ */
+class StreamingDelaunay
+{
+public:
+  StreamingDelaunay(StreamGrid const &grid, BufferedWriter &out);
+
+  void insert(int x, int y);
+  void finalizeCell(int cell);
+
+  /**
+   * Write every triangle still in memory. Must be called at the end of the stream.
+   */
+  void finish();
+
+  /**
+   * Largest number of triangles held at once.
+   */
+  size_t peakTriangles() const { return peak; }
+
+private:
+  struct Vertex
+  {
+    int x, y;
+    int id;
+    int triangles;
+    bool written;
+  };
+
+  struct Triangle
+  {
+    // counterclockwise; neighbor[i] is across the edge opposite vertex[i], or -1 once written
+    int vertex[3];
+    int neighbor[3];
+    unsigned generation;
+    unsigned mark;
+    bool live;
+  };
+
+  static constexpr int ghost = 0;
+
+  int newVertex(int x, int y, int id);
+  int newTriangle(int a, int b, int c);
+  void releaseTriangle(int t);
+
+  bool isGhost(int t) const;
+  bool inConflict(int t, Vertex const &p) const;
+  int locate(Vertex const &p, int start);
+  void start();
+  void insertVertex(int v);
+
+  /**
+   * Wait for the first open cell covered by the circumcircle of t, or write t if there is none.
+   */
+  void schedule(int t);
+  void write(int t);
+
+private:
+  StreamGrid grid;
+  BufferedWriter &out;
+
+  std::vector<Vertex> vertices;
+  std::vector<int> freeVertices;
+  std::vector<Triangle> triangles;
+  std::vector<int> freeTriangles;
+  size_t liveTriangles, peak;
+
+  std::vector<char> finalized;
+  // triangles waiting for each cell, with their generation to skip the ones released since
+  std::vector<std::vector<std::pair<int, unsigned>>> waiting;
+  // a triangle created by the last insertion in each cell, to start the next walk from
+  std::vector<int> hook;
+
+  // sites received before the first three non colinear ones
+  std::vector<Vertex> pending;
+  bool started;
+  int siteCount;
+  unsigned insertion;
+  int lastTriangle;
+
+  // scratch space of insertVertex
+  std::vector<int> cavity, stack;
+  std::vector<std::pair<int, int>> boundary;
+  std::vector<int> created;
+  std::unordered_map<int, int> createdByFirst;
+};
+
+/**
+ * Read a tagged stream from the standard input and write its triangulation to the standard output.
+ *
+ * The stream is made of the grid "g cols rows minX minY maxX maxY", then sites "v x y" and tags "f cell" in any
+ * order.
+ */
+void streamDelaunay();
+
+/**
+ * Turn a site list in the usual input format into a tagged stream over a resolution x resolution grid. Sites are
+ * written one row of cells at a time, and the cells of a row are finalized after it, so the triangulation front
+ * stays about one row wide. Each row is one more pass over the input, which is mapped when it is a file.
+ */
+void tagSitesByGrid(int resolution);
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+/**
+ * Fixed set of worker threads that run parallel loops.
+ *
+ * The thread that calls parallelFor also takes part in the loop, so a pool of one thread runs everything inline.
+ * Only one loop runs at a time and parallelFor must not be called from inside a task.
+ */
+class ThreadPool
+{
+public:
+  /**
+   * Create a pool with the given number of threads (including the caller). 0 means one per hardware thread.
+   */
+  ThreadPool(unsigned threads = 0);
+  ~ThreadPool();
+
+  ThreadPool(ThreadPool const &) = delete;
+  ThreadPool &operator=(ThreadPool const &) = delete;
+
+  unsigned size() const { return unsigned(workers.size()) + 1; }
+
+  /**
+   * Call task(i) for every i in [0, count) and return when all calls are done.
+   */
+  void parallelFor(size_t count, std::function<void(size_t)> const &task);
+
+private:
+  void work();
+  void runTasks();
+
+private:
+  std::vector<std::thread> workers;
+  std::mutex mutex;
+  std::condition_variable wake, finished;
+
+  std::function<void(size_t)> const *job;
+  size_t jobSize;
+  std::atomic<size_t> nextTask;
+  size_t busy;
+  unsigned long generation;
+  bool stopping;
+};
+
+#endif
@@ -39,6 +39,11 @@ bool compareDoubleEqual(double a, double b);
 
 bool compareDoublePointEqual(PointDouble const &a, PointDouble const &b);
 
+/**
+ * Position of a cell along the Hilbert curve that covers a 2^16 x 2^16 grid.
+ */
+unsigned long long hilbertIndex(unsigned x, unsigned y);
+
 
 template<typename T>
 class PointPointerComparison
@@ -2,12 +2,15 @@
 #define VORONOI_H
 
 #include <vector>
-#include <queue>
 #include <map>
+#include <queue>
 #include "./point.hpp"
 #include "./delaunay.hpp"
 #include "./utils.hpp"
 #include "./geometricFunctions.hpp"
+#include "./arena.hpp"
+#include "./compactDcel.hpp"
+#include "./fortune.hpp"
 
 enum class corners
 {
@@ -21,43 +24,195 @@ class Voronoi
 {
 public:
   Voronoi() {}
-  Voronoi(Delaunay const &del);
-  friend void printVoronoi(Voronoi const &vor);
+  /**
+   * Build the diagram from a triangulation. The circuncenters of large triangulations are computed on [threads]
+   * threads, 0 meaning one per hardware thread.
+   */
+  Voronoi(Delaunay const &del, unsigned threads = 0);
+
+  /**
+   * Build the diagram directly from the sites with Fortune's algorithm, without a triangulation.
+   */
+  Voronoi(pointIntVector const &input);
+
+  /**
+   * Repair a diagram built from del after del.insert, del.remove or del.moveSites, which must be applied one at a
+   * time. Only the cells of the sites in the update are rebuilt: the edges between them are deleted, along with
+   * the points where they met the box, and the new ones are spliced in around their vertices.
+   *
+   * The box is kept as long as the sites stay inside it. A site inserted outside of it, or an update that rebuilt
+   * the triangulation, rebuilds the whole diagram. Moves resize the box to the new bounding box instead, which
+   * rebuilds the cells of the hull sites; moves that touch more than half of the sites rebuild everything.
+   */
+  void update(Delaunay const &del, DelaunayUpdate const &change);
+
+  /**
+   * Build the diagram of another triangulation in place of this one, keeping the memory of the arena. threads is
+   * used like in the constructor.
+   */
+  void reset(Delaunay const &del, unsigned threads = 0);
+  friend void printVoronoi(Voronoi const &vor, unsigned threads);
+  friend CompactDcel<double> compactVoronoi(Voronoi const &vor);
 
 private:
+  void build(Delaunay const &del);
+  void clear();
   void prepareVoronoi();
+
+  /**
+   * Fill boundaryIndex from the four sides of the box, which must have no point but the corners. firstEdge is the
+   * inner edge that leaves the top right corner.
+   */
+  void indexBoundary(HalfEdge<double> *firstEdge);
+
+  /**
+   * Move the corners of a box that has no point but them, and index its sides again.
+   */
+  void resizeBoundary(double minX, double maxX, double minY, double maxY);
   void buildDiagram(Delaunay const &del);
 
+  /**
+   * Fill triangleCircuncenters: gather the triangles into a CircuncenterBatch, compute it, then merge coincident
+   * circuncenters of neighbor triangles in a separate pass.
+   */
+  void computeCircuncenters(Delaunay const &del);
+
+  /**
+   * Turn a clipped Voronoi graph into the diagram's DCEL. The half-edges leaving each vertex are sorted by angle
+   * and every cycle of the resulting chains, except the one around the box, becomes the cell of a site.
+   */
+  void assembleDiagram(VoronoiGraph const &graph);
+
   HalfEdge<double> *createInfiniteEdge(HalfEdge<int> *edge);
   HalfEdge<double> *createSemiInfiniteEdge(HalfEdge<int> *edge, bool reverse);
   HalfEdge<double> *createEdge(HalfEdge<int> *edge);
+
+  /**
+   * Append the face to diagramFaces, using its position as its id. Vertices are numbered the same way, from 1.
+   */
+  void addFace(Face<double> *face);
+  void addVertex(PointDouble *vertex);
+
+  /**
+   * Destroy a face or a vertex, moving the last one of its list to its position.
+   */
+  void removeFace(Face<double> *face);
+  void removeVertex(PointDouble *vertex);
+
+  /**
+   * Delete an edge and its twin, joining the chains around them.
+   */
+  void removeEdge(HalfEdge<double> *edge);
+
+  /**
+   * Join the two sides of the box around a point that no edge meets anymore.
+   */
+  void removeBoundaryPoint(PointDouble *p);
+
+  /**
+   * Direction of an edge of the diagram as the dual of the triangulation sees it: perpendicular to the sites of its
+   * two cells, even when a circuncenter outside the box reverses the segment. Sides of the box keep their own.
+   */
+  PointDouble edgeDirection(HalfEdge<double> const *edge) const;
+
+  /**
+   * Create the edge from -> to between two cells and its twin, linking each one in the star of its origin by
+   * edgeDirection.
+   */
+  HalfEdge<double> *spliceEdge(PointDouble *from, PointDouble *to, Face<double> *cell, Face<double> *otherCell);
+
+  /**
+   * Clip the ray of a hull edge of the triangulation, which has the outer face on its right. Return the inner
+   * boundary segment that starts where the ray meets the box.
+   */
+  HalfEdge<double> *clipHullRay(HalfEdge<int> *edge);
+
+  /**
+   * Position of a site of the triangulation in sites. Sites are numbered from 1 by the Delaunay constructor.
+   */
+  static int siteIndex(PointInt const *site) { return site->getId() - 1; }
+
+  /**
+   * Remove a zero-length edge, joining the edge chains around it.
+   */
+  void contractEdge(HalfEdge<double> *edge);
   // void processCoincidentCircuncenter(HalfEdge<int> *edge);
 
   /**
-   * Find corresponding half-edge in the boundary that contains given point.
-   * 
-   * Since the edge chain will be transversed clockwise, corner and evaluation order must be chosen accordingly.
-   * 
-   * Return the inner edge segment segment.
+   * Point where an infinite edge meets the boundary: its parameter along the edge and the inner boundary segment
+   * that starts at it.
    */
-  HalfEdge<double> *findBoundingSegment(PointDouble const &p, corners corner, geo::axis axis, geo::order order);
+  struct BoundaryHit
+  {
+    double t;
+    HalfEdge<double> *edge;
+  };
+
+  /**
+   * Find corresponding half-edge in the side of the boundary that starts at corner and contains the point with the
+   * given coordinate along the side. Since the edge chain will be transversed clockwise, the coordinate ascends
+   * along the top and left sides and descends along the others.
+   *
+   * Return the inner edge segment. The segment is found by a binary search in boundaryIndex.
+   */
+  template <corners corner>
+  HalfEdge<double> *findBoundingSegment(double coord);
+
+  /**
+   * Split a segment of the boundary found by findBoundingSegment at p, keeping boundaryIndex up to date.
+   */
+  template <corners corner>
+  void insertBoundaryPoint(PointDouble *p, HalfEdge<double> *segment);
+
+  /**
+   * Clip the line (or, if ray is set, the ray) from point along normal against one side of the boundary. A
+   * vertex is created only if the hit is not an existing point of the side.
+   *
+   * Return false if the side is not hit.
+   */
+  template <corners corner, bool ray>
+  bool clipToSide(PointDouble const &point, PointDouble const &normal, BoundaryHit &hit);
+
+  /**
+   * Clip against the four sides in turn, filling hits. Return the number of sides hit.
+   */
+  template <bool ray>
+  int clipToBoundary(PointDouble const &point, PointDouble const &normal, BoundaryHit hits[2]);
 
 public:
   std::vector<PointInt *> sites;
   std::vector<PointDouble *> diagramVertices;
+
+  // The id of each face is its position here
   std::vector<Face<double> *> diagramFaces;
 
+  // Site of each face of diagramFaces, or nullptr for faces that are not a cell
+  std::vector<PointInt *> siteFaceReference;
+
 private:
+  // Owns every vertex, half-edge and face of the diagram
+  DcelArena<double> arena;
+
   double boundaryMaxX, boundaryMinX, boundaryMaxY, boundaryMinY;
+  unsigned threads = 0;
 
   // External bounding edges that begins at the bounding vertices
   std::vector<HalfEdge<double> *> cornerExternalBoundingEdge;
 
+  // Points of each side of the boundary, indexed by the corner the side starts at, with the inner edge that leaves
+  // each of them along the side. Keys are the coordinate along the side, negated on the descending sides so the
+  // maps follow the walking order. The last key of a side is the first point of the next one.
+  std::map<double, HalfEdge<double> *> boundaryIndex[4];
+
   std::priority_queue<PointInt *, std::vector<PointInt *>, PointPointerComparison<int>> sitesQueue;
-  std::map<Face<int> *, Point<double> *> triangleCircuncenters;
-  std::map<HalfEdge<int> *, HalfEdge<double> *> edgeReference;
-  std::map<Face<double> *, PointInt *> siteFaceReference;
-  std::map<PointInt *, Face<double> *> faceReference;
+
+  // Tables indexed by the dense ids of the triangulation: circumcenter of each face and diagram edge of each
+  // half-edge (nullptr until it is created)
+  std::vector<Point<double> *> triangleCircuncenters;
+  std::vector<HalfEdge<double> *> edgeReference;
+
+  // Cell of each site, indexed by siteIndex()
+  std::vector<Face<double> *> faceReference;
 };
 
 #endif
\ No newline at end of file
@@ -3,6 +3,10 @@ for file in testes/*
 do
     echo
     echo "testing $file"
+    ./voronoi < "$file" > text.out
+    ./voronoi --binary < "$file" > binary.out
+    ./voronoi --print-binary binary.out | cmp -s - text.out || echo "binary round trip differs from the text output"
+    rm -f text.out binary.out
     ./voronoi < "$file" | python3 draw.py
     # ./voronoi < "$file" 
 done
\ No newline at end of file
@@ -0,0 +1,189 @@
+#include "../include/batch.hpp"
+#include "../include/ioFunctions.hpp"
+#include "../include/inputBuffer.hpp"
+#include "../include/threadPool.hpp"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <atomic>
+#include <charconv>
+#include <algorithm>
+
+namespace
+{
+  /**
+   * A site set of the stream, as the text of its number of sites and coordinates, or a file to read it from.
+   * A job whose set could not be delimited has its error already set.
+   */
+  struct BatchJob
+  {
+    std::string path;
+    char const *begin = nullptr, *end = nullptr;
+    std::string error;
+  };
+}
+
+/**
+ * Read a whole file into buffer. Return false if it can not be read.
+ */
+static bool readFile(std::string const &path, std::vector<char> &buffer)
+{
+  std::ifstream in(path, std::ios::binary);
+  if (!in || !in.seekg(0, std::ios::end))
+    return false;
+  auto size = in.tellg();
+  if (size < 0 || !in.seekg(0, std::ios::beg))
+    return false;
+  buffer.resize(size_t(size));
+  return bool(in.read(buffer.data(), size));
+}
+
+std::string BatchWorker::run(char const *begin, char const *end, DelaunayOptions options, bool onlyDelaunay, BufferedWriter &out)
+{
+  auto error = parseSites(begin, end, storage, sites);
+  if (!error.empty())
+    return error;
+  if (sites.empty())
+    return "the set has no sites";
+
+  // the bounding triangle of the incremental engine is empty when every site is at the same place
+  bool coincident = true;
+  for (auto const &p : sites)
+    coincident = coincident && p->x == sites[0]->x && p->y == sites[0]->y;
+  if (coincident)
+    options.engine = DelaunayEngine::divideAndConquer;
+  options.threads = 1;
+
+  delaunay.reset(sites, options);
+  if (onlyDelaunay)
+  {
+    writeDelaunay(delaunay, out);
+    return "";
+  }
+  voronoi.reset(delaunay, 1);
+  writeVoronoi(voronoi, out);
+  return "";
+}
+
+/**
+ * Run one job with the worker. Return an empty string, or the reason it failed.
+ */
+static std::string runJob(BatchJob const &job, BatchWorker &worker, DelaunayOptions const &options, BufferedWriter &out)
+{
+  if (!job.error.empty())
+    return job.error;
+  if (job.path.empty())
+    return worker.run(job.begin, job.end, options, false, out);
+  if (!readFile(job.path, worker.input))
+    return "could not read " + job.path;
+  return worker.run(worker.input.data(), worker.input.data() + worker.input.size(), options, false, out);
+}
+
+/**
+ * Run the jobs a round at a time and write their diagrams, or their errors, in order.
+ */
+static int runJobs(std::vector<BatchJob> const &jobs, DelaunayOptions const &options)
+{
+  // the counters of the instrumentation must only be updated by one thread
+  unsigned threads = options.threads;
+  STATS_ONLY(threads = 1);
+  ThreadPool pool(threads);
+  std::vector<BatchWorker> workers(pool.size());
+
+  size_t const round = 64 * workers.size();
+  std::vector<BufferedWriter> texts(round);
+  std::vector<std::string> errors(round);
+  BufferedWriter out(&std::cout);
+  int failed = 0;
+  for (size_t first = 0; first < jobs.size(); first += round)
+  {
+    size_t count = std::min(round, jobs.size() - first);
+    std::atomic<size_t> next(0);
+    pool.parallelFor(workers.size(), [&](size_t w) {
+      for (size_t i = next++; i < count; i = next++)
+      {
+        texts[i].clear();
+        errors[i] = runJob(jobs[first + i], workers[w], options, texts[i]);
+      }
+    });
+
+    for (size_t i = 0; i < count; i++)
+    {
+      if (errors[i].empty())
+      {
+        out << texts[i];
+        continue;
+      }
+      auto const &job = jobs[first + i];
+      std::cerr << "Job " << first + i + 1 << (job.path.empty() ? "" : " (" + job.path + ")") << ": " << errors[i] << "\n";
+      out << "error " << errors[i].c_str() << '\n';
+      failed++;
+    }
+  }
+  return failed;
+}
+
+/**
+ * Start of the token at or after begin, or end.
+ */
+static char const *skipBlanks(char const *begin, char const *end)
+{
+  while (begin < end && isBlank(*begin))
+    begin++;
+  return begin;
+}
+
+int runBatch(DelaunayOptions const &options)
+{
+  InputBuffer input;
+  char const *begin = input.begin(), *end = input.end();
+
+  // each set ends after the 2n tokens that follow its number of sites, whatever they are, so a malformed
+  // coordinate only fails its own set
+  std::vector<BatchJob> jobs;
+  while ((begin = skipBlanks(begin, end)) < end)
+  {
+    BatchJob job;
+    job.begin = begin;
+    long long n;
+    auto header = std::from_chars(begin, end, n);
+    if (header.ec != std::errc() || n < 0 || (header.ptr < end && !isBlank(*header.ptr)))
+    {
+      job.error = "the first value must be the number of sites; the rest of the input is skipped";
+      jobs.push_back(job);
+      break;
+    }
+    begin = header.ptr;
+    for (long long token = 0; token < 2 * n && (begin = skipBlanks(begin, end)) < end; token++)
+    {
+      while (begin < end && !isBlank(*begin))
+        begin++;
+    }
+    job.end = begin;
+    jobs.push_back(job);
+  }
+  return runJobs(jobs, options);
+}
+
+int runBatchFiles(char const *listPath, DelaunayOptions const &options)
+{
+  std::ifstream list(listPath);
+  if (!list)
+  {
+    std::cerr << "Could not open " << listPath << "\n";
+    exit(-1);
+  }
+
+  std::vector<BatchJob> jobs;
+  std::string line;
+  while (std::getline(list, line))
+  {
+    if (!line.empty() && line.back() == '\r')
+      line.pop_back();
+    if (line.empty())
+      continue;
+    jobs.push_back(BatchJob());
+    jobs.back().path = line;
+  }
+  return runJobs(jobs, options);
+}
@@ -0,0 +1,138 @@
+#include "../include/binaryDcel.hpp"
+#include <iostream>
+#include <vector>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "The binary DCEL is written and mapped in the native byte order, which must be little-endian"
+#endif
+
+static_assert(sizeof(binary::Header) == 24, "unexpected padding in binary::Header");
+static_assert(sizeof(binary::EdgeRecord) == 20, "unexpected padding in binary::EdgeRecord");
+static_assert(sizeof(binary::FaceRecord) == 16, "unexpected padding in binary::FaceRecord");
+
+static size_t align8(size_t size)
+{
+  return (size + 7) & ~size_t(7);
+}
+
+/**
+ * Offsets of the arrays from the beginning of the file, and the size of the file.
+ */
+struct Layout
+{
+  size_t x, y, vertexEdge, halfEdges, faces, end;
+
+  Layout(uint64_t vertices, uint64_t halfEdges, uint64_t faces)
+  {
+    x = align8(sizeof(binary::Header));
+    y = x + vertices * sizeof(double);
+    vertexEdge = y + vertices * sizeof(double);
+    this->halfEdges = align8(vertexEdge + vertices * sizeof(uint32_t));
+    this->faces = align8(this->halfEdges + halfEdges * sizeof(binary::EdgeRecord));
+    end = this->faces + faces * sizeof(binary::FaceRecord);
+  }
+};
+
+static void writeSection(std::ostream &out, size_t &position, size_t offset, void const *data, size_t size)
+{
+  static char const padding[8] = {};
+  out.write(padding, offset - position);
+  out.write(static_cast<char const *>(data), size);
+  position = offset + size;
+}
+
+void writeBinaryVoronoi(CompactDcel<double> const &dcel, std::ostream &out)
+{
+  // number the half-edges and the cells like the text output
+  std::vector<uint32_t> edgeIds(dcel.numHalfEdges(), binary::none);
+  std::vector<uint32_t> faceIds(dcel.numFaces(), binary::none);
+  std::vector<binary::FaceRecord> faces;
+  for (size_t i = 0; i < dcel.edgeOrder.size(); i++)
+    edgeIds[dcel.edgeOrder[i]] = uint32_t(i);
+  for (uint32_t f = 0; f < dcel.numFaces(); f++)
+  {
+    if (dcel.siteId[f] >= 0)
+    {
+      faceIds[f] = uint32_t(faces.size());
+      faces.push_back({edgeIds[dcel.faceEdge[f]], dcel.siteX[f], dcel.siteY[f], dcel.siteId[f]});
+    }
+  }
+
+  std::vector<uint32_t> vertexEdge(dcel.numVertices());
+  for (uint32_t v = 0; v < dcel.numVertices(); v++)
+    vertexEdge[v] = dcel.vertexEdge[v] != dcel.none ? edgeIds[dcel.vertexEdge[v]] : binary::none;
+
+  std::vector<binary::EdgeRecord> halfEdges(dcel.edgeOrder.size());
+  for (size_t i = 0; i < dcel.edgeOrder.size(); i++)
+  {
+    auto e = dcel.edgeOrder[i];
+    halfEdges[i] = {dcel.origin[e], edgeIds[dcel.twin(e)], dcel.face[e] != dcel.none ? faceIds[dcel.face[e]] : binary::none,
+                    edgeIds[dcel.next[e]], edgeIds[dcel.prev[e]]};
+  }
+
+  binary::Header header;
+  memcpy(header.magic, binary::magic, sizeof(header.magic));
+  header.version = binary::version;
+  header.numVertices = dcel.numVertices();
+  header.numHalfEdges = uint32_t(halfEdges.size());
+  header.numFaces = uint32_t(faces.size());
+
+  Layout layout(header.numVertices, header.numHalfEdges, header.numFaces);
+  size_t position = 0;
+  writeSection(out, position, 0, &header, sizeof(header));
+  writeSection(out, position, layout.x, dcel.x.data(), dcel.x.size() * sizeof(double));
+  writeSection(out, position, layout.y, dcel.y.data(), dcel.y.size() * sizeof(double));
+  writeSection(out, position, layout.vertexEdge, vertexEdge.data(), vertexEdge.size() * sizeof(uint32_t));
+  writeSection(out, position, layout.halfEdges, halfEdges.data(), halfEdges.size() * sizeof(binary::EdgeRecord));
+  writeSection(out, position, layout.faces, faces.data(), faces.size() * sizeof(binary::FaceRecord));
+  out.flush();
+}
+
+static void invalidFile(char const *path, char const *reason)
+{
+  std::cerr << path << ": " << reason << "\n";
+  exit(-1);
+}
+
+BinaryDcel::BinaryDcel(char const *path) : mapped(nullptr), length(0)
+{
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    invalidFile(path, "can not open the file");
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || size_t(info.st_size) < sizeof(binary::Header))
+    invalidFile(path, "not a binary DCEL");
+  length = info.st_size;
+  mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED)
+    invalidFile(path, "can not map the file");
+
+  header = static_cast<binary::Header const *>(mapped);
+  if (memcmp(header->magic, binary::magic, sizeof(binary::magic)) != 0)
+    invalidFile(path, "not a binary DCEL");
+  if (header->version != binary::version)
+    invalidFile(path, "unsupported binary DCEL version");
+
+  Layout layout(header->numVertices, header->numHalfEdges, header->numFaces);
+  if (layout.end > length)
+    invalidFile(path, "truncated binary DCEL");
+
+  auto base = static_cast<char const *>(mapped);
+  x = reinterpret_cast<double const *>(base + layout.x);
+  y = reinterpret_cast<double const *>(base + layout.y);
+  vertexEdge = reinterpret_cast<uint32_t const *>(base + layout.vertexEdge);
+  halfEdges = reinterpret_cast<binary::EdgeRecord const *>(base + layout.halfEdges);
+  faces = reinterpret_cast<binary::FaceRecord const *>(base + layout.faces);
+}
+
+BinaryDcel::~BinaryDcel()
+{
+  munmap(const_cast<void *>(mapped), length);
+}
@@ -0,0 +1,41 @@
+#include "../include/bufferedWriter.hpp"
+#include <cstring>
+
+BufferedWriter::BufferedWriter(std::ostream *out, size_t capacity) : out(out), capacity(capacity)
+{
+  if (out != nullptr)
+    text.reserve(capacity + 64);
+}
+
+BufferedWriter::~BufferedWriter()
+{
+  flush();
+}
+
+BufferedWriter &BufferedWriter::operator<<(double value)
+{
+  char digits[32];
+  auto end = std::to_chars(digits, digits + sizeof(digits), value, std::chars_format::general, 6).ptr;
+  text.append(digits, end);
+  return commit();
+}
+
+BufferedWriter &BufferedWriter::operator<<(char const *s)
+{
+  text.append(s, strlen(s));
+  return commit();
+}
+
+BufferedWriter &BufferedWriter::operator<<(BufferedWriter const &other)
+{
+  text.append(other.text);
+  return commit();
+}
+
+void BufferedWriter::flush()
+{
+  if (out == nullptr || text.empty())
+    return;
+  out->write(text.data(), text.size());
+  text.clear();
+}
@@ -0,0 +1,122 @@
+#include "../include/circuncenterBatch.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CIRCUNCENTER_X86
+#endif
+
+void CircuncenterBatch::resize(size_t n)
+{
+  x1.resize(n);
+  y1.resize(n);
+  x2.resize(n);
+  y2.resize(n);
+  x3.resize(n);
+  y3.resize(n);
+  centerX.resize(n);
+  centerY.resize(n);
+}
+
+typedef void (*CircuncenterKernel)(CircuncenterBatch &batch, size_t begin, size_t end);
+
+static void scalarKernel(CircuncenterBatch &b, size_t begin, size_t end)
+{
+  for (size_t i = begin; i < end; i++)
+  {
+    double ax = b.x1[i], ay = b.y1[i];
+    double bx = b.x2[i], by = b.y2[i];
+    double cx = b.x3[i], cy = b.y3[i];
+
+    double d = 2 * (ax * (by - cy) + bx * (cy - ay) + cx * (ay - by));
+    double a2 = ax * ax + ay * ay;
+    double b2 = bx * bx + by * by;
+    double c2 = cx * cx + cy * cy;
+    b.centerX[i] = (a2 * (by - cy) + b2 * (cy - ay) + c2 * (ay - by)) / d;
+    b.centerY[i] = (a2 * (cx - bx) + b2 * (ax - cx) + c2 * (bx - ax)) / d;
+  }
+}
+
+#ifdef CIRCUNCENTER_X86
+
+/*
+ * Both vector kernels spell out each multiplication and addition, so no fused multiply-add changes the rounding.
+ */
+
+static void sse2Kernel(CircuncenterBatch &b, size_t begin, size_t end)
+{
+  size_t i = begin;
+  __m128d two = _mm_set1_pd(2);
+  for (; i + 2 <= end; i += 2)
+  {
+    __m128d ax = _mm_loadu_pd(&b.x1[i]), ay = _mm_loadu_pd(&b.y1[i]);
+    __m128d bx = _mm_loadu_pd(&b.x2[i]), by = _mm_loadu_pd(&b.y2[i]);
+    __m128d cx = _mm_loadu_pd(&b.x3[i]), cy = _mm_loadu_pd(&b.y3[i]);
+
+    __m128d byCy = _mm_sub_pd(by, cy), cyAy = _mm_sub_pd(cy, ay), ayBy = _mm_sub_pd(ay, by);
+    __m128d cxBx = _mm_sub_pd(cx, bx), axCx = _mm_sub_pd(ax, cx), bxAx = _mm_sub_pd(bx, ax);
+
+    __m128d d = _mm_add_pd(_mm_add_pd(_mm_mul_pd(ax, byCy), _mm_mul_pd(bx, cyAy)), _mm_mul_pd(cx, ayBy));
+    d = _mm_mul_pd(two, d);
+    __m128d a2 = _mm_add_pd(_mm_mul_pd(ax, ax), _mm_mul_pd(ay, ay));
+    __m128d b2 = _mm_add_pd(_mm_mul_pd(bx, bx), _mm_mul_pd(by, by));
+    __m128d c2 = _mm_add_pd(_mm_mul_pd(cx, cx), _mm_mul_pd(cy, cy));
+
+    __m128d ux = _mm_add_pd(_mm_add_pd(_mm_mul_pd(a2, byCy), _mm_mul_pd(b2, cyAy)), _mm_mul_pd(c2, ayBy));
+    __m128d uy = _mm_add_pd(_mm_add_pd(_mm_mul_pd(a2, cxBx), _mm_mul_pd(b2, axCx)), _mm_mul_pd(c2, bxAx));
+    _mm_storeu_pd(&b.centerX[i], _mm_div_pd(ux, d));
+    _mm_storeu_pd(&b.centerY[i], _mm_div_pd(uy, d));
+  }
+  scalarKernel(b, i, end);
+}
+
+__attribute__((target("avx2"))) static void avx2Kernel(CircuncenterBatch &b, size_t begin, size_t end)
+{
+  size_t i = begin;
+  __m256d two = _mm256_set1_pd(2);
+  for (; i + 4 <= end; i += 4)
+  {
+    __m256d ax = _mm256_loadu_pd(&b.x1[i]), ay = _mm256_loadu_pd(&b.y1[i]);
+    __m256d bx = _mm256_loadu_pd(&b.x2[i]), by = _mm256_loadu_pd(&b.y2[i]);
+    __m256d cx = _mm256_loadu_pd(&b.x3[i]), cy = _mm256_loadu_pd(&b.y3[i]);
+
+    __m256d byCy = _mm256_sub_pd(by, cy), cyAy = _mm256_sub_pd(cy, ay), ayBy = _mm256_sub_pd(ay, by);
+    __m256d cxBx = _mm256_sub_pd(cx, bx), axCx = _mm256_sub_pd(ax, cx), bxAx = _mm256_sub_pd(bx, ax);
+
+    __m256d d = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(ax, byCy), _mm256_mul_pd(bx, cyAy)), _mm256_mul_pd(cx, ayBy));
+    d = _mm256_mul_pd(two, d);
+    __m256d a2 = _mm256_add_pd(_mm256_mul_pd(ax, ax), _mm256_mul_pd(ay, ay));
+    __m256d b2 = _mm256_add_pd(_mm256_mul_pd(bx, bx), _mm256_mul_pd(by, by));
+    __m256d c2 = _mm256_add_pd(_mm256_mul_pd(cx, cx), _mm256_mul_pd(cy, cy));
+
+    __m256d ux = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(a2, byCy), _mm256_mul_pd(b2, cyAy)), _mm256_mul_pd(c2, ayBy));
+    __m256d uy = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(a2, cxBx), _mm256_mul_pd(b2, axCx)), _mm256_mul_pd(c2, bxAx));
+    _mm256_storeu_pd(&b.centerX[i], _mm256_div_pd(ux, d));
+    _mm256_storeu_pd(&b.centerY[i], _mm256_div_pd(uy, d));
+  }
+  sse2Kernel(b, i, end);
+}
+
+static CircuncenterKernel selectKernel()
+{
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return avx2Kernel;
+  if (__builtin_cpu_supports("sse2"))
+    return sse2Kernel;
+  return scalarKernel;
+}
+
+#else
+
+static CircuncenterKernel selectKernel()
+{
+  return scalarKernel;
+}
+
+#endif
+
+void CircuncenterBatch::compute(size_t begin, size_t end)
+{
+  static CircuncenterKernel const kernel = selectKernel();
+  kernel(*this, begin, end);
+}
@@ -0,0 +1,101 @@
+#include "../include/compactDcel.hpp"
+#include "../include/delaunay.hpp"
+#include "../include/voronoi.hpp"
+#include <unordered_map>
+
+/**
+ * Copy the half-edge links of a pointer DCEL into the compact one.
+ */
+template <typename T>
+static void linkEdges(CompactDcel<T> &dcel, std::unordered_map<HalfEdge<T> *, uint32_t> const &edgeIndex, std::unordered_map<Face<T> *, uint32_t> const &faceIndex)
+{
+  for (auto const &entry : edgeIndex)
+  {
+    auto e = entry.first;
+    auto idx = entry.second;
+    dcel.next[idx] = edgeIndex.at(e->next());
+    dcel.prev[idx] = edgeIndex.at(e->prev());
+    if (e->face() != nullptr && faceIndex.count(e->face()) > 0)
+      dcel.face[idx] = faceIndex.at(e->face());
+  }
+}
+
+CompactDcel<int> compactDelaunay(Delaunay const &del)
+{
+  CompactDcel<int> dcel;
+  std::unordered_map<PointInt *, uint32_t> vertexIndex;
+  std::unordered_map<HalfEdge<int> *, uint32_t> edgeIndex;
+  std::unordered_map<Face<int> *, uint32_t> faceIndex;
+
+  dcel.reserve(del.points.size(), 6 * del.points.size(), del.faces.size());
+
+  for (auto const &p : del.points)
+    vertexIndex[p] = dcel.addVertex(p->x, p->y, p->getId());
+
+  for (auto const &p : del.points)
+  {
+    for (auto const &e : p->outgoingEdges())
+    {
+      if (edgeIndex.count(e) == 0)
+      {
+        auto idx = dcel.addEdge(vertexIndex.at(e->from()), vertexIndex.at(e->to()));
+        edgeIndex[e] = idx;
+        edgeIndex[e->twin()] = dcel.twin(idx);
+      }
+      dcel.edgeOrder.push_back(edgeIndex[e]);
+    }
+    if (p->outgoingEdge() != nullptr)
+      dcel.vertexEdge[vertexIndex[p]] = edgeIndex[p->outgoingEdge()];
+  }
+
+  for (auto const &f : del.faces)
+    faceIndex[f] = dcel.addFace(edgeIndex.at(f->edgeChain()));
+
+  linkEdges(dcel, edgeIndex, faceIndex);
+  return dcel;
+}
+
+CompactDcel<double> compactVoronoi(Voronoi const &vor)
+{
+  CompactDcel<double> dcel;
+  std::unordered_map<PointDouble *, uint32_t> vertexIndex;
+  std::unordered_map<HalfEdge<double> *, uint32_t> edgeIndex;
+  std::unordered_map<Face<double> *, uint32_t> faceIndex;
+
+  dcel.reserve(vor.diagramVertices.size(), 6 * vor.diagramVertices.size(), vor.diagramFaces.size());
+
+  for (auto const &p : vor.diagramVertices)
+    vertexIndex[p] = dcel.addVertex(p->x, p->y, p->getId());
+
+  for (auto const &p : vor.diagramVertices)
+  {
+    for (auto const &e : p->outgoingEdges())
+    {
+      if (edgeIndex.count(e) == 0)
+      {
+        auto idx = dcel.addEdge(vertexIndex.at(e->from()), vertexIndex.at(e->to()));
+        edgeIndex[e] = idx;
+        edgeIndex[e->twin()] = dcel.twin(idx);
+      }
+      dcel.edgeOrder.push_back(edgeIndex[e]);
+    }
+    if (p->outgoingEdge() != nullptr)
+      dcel.vertexEdge[vertexIndex[p]] = edgeIndex[p->outgoingEdge()];
+  }
+
+  for (auto const &f : vor.diagramFaces)
+  {
+    auto idx = dcel.addFace(edgeIndex.at(f->edgeChain()));
+    faceIndex[f] = idx;
+    auto site = vor.siteFaceReference[f->getId()];
+    if (site != nullptr)
+    {
+      dcel.siteX[idx] = site->x;
+      dcel.siteY[idx] = site->y;
+      dcel.siteId[idx] = site->getId();
+    }
+  }
+
+  linkEdges(dcel, edgeIndex, faceIndex);
+  return dcel;
+}
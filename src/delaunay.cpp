@@ -3,6 +3,64 @@
 #include "../include/utils.hpp"
 #include "../include/ioFunctions.hpp"
 #include <iostream>
+#include <algorithm>
+#include <unordered_set>
+
+void Delaunay::build(std::vector<PointInt *> &p, DelaunayOptions const &options)
+{
+  int maxX = std::numeric_limits<int>::min();
+  int minX = std::numeric_limits<int>::max();
+  int maxY = std::numeric_limits<int>::min();
+  int minY = std::numeric_limits<int>::max();
+
+  for (auto &point : p)
+  {
+    maxX = point->x > maxX ? point->x : maxX;
+    minX = point->x < minX ? point->x : minX;
+
+    maxY = point->y > maxY ? point->y : maxY;
+    minY = point->y < minY ? point->x : minY;
+    points.push_back(point);
+    point->setId(int(points.size()));
+  }
+  if (options.engine == DelaunayEngine::divideAndConquer)
+  {
+    STATS_START(triangulate);
+    divideAndConquer(options.threads);
+    STATS_STOP(triangulate);
+    return;
+  }
+  if (options.engine == DelaunayEngine::tiled)
+  {
+    STATS_START(triangulate);
+    tiledDivideAndConquer(options.threads, options.tiles);
+    STATS_STOP(triangulate);
+    return;
+  }
+  if (options.spatialSort)
+    sortPoints();
+  prepareTriangulation(minX, maxX, minY, maxY);
+  triangulate();
+
+  // back to input order, so the site with id i is points[i - 1] as insert, remove and moveSites expect
+  if (options.spatialSort)
+    std::sort(points.begin(), points.end(), [](PointInt const *a, PointInt const *b) { return a->getId() < b->getId(); });
+}
+
+void Delaunay::reset(std::vector<PointInt *> &p, DelaunayOptions const &options)
+{
+  points.clear();
+  faces.clear();
+  arena.reset();
+  for (auto &a : chunkArenas)
+    a.reset();
+  computationPoints.clear();
+  history.clear();
+  useWalk = options.spatialSort;
+  rng.seed(options.seed);
+  lastFace = nullptr;
+  build(p, options);
+}
 
 /**
  * Compute bounding triangle 
@@ -15,14 +73,14 @@ void Delaunay::prepareTriangulation(int minX, int maxX, int minY, int maxY)
   int meanY = deltaY / 2;
   int meanDelta = (deltaX + deltaY) / 2;
 
-  auto top = new PointInt(meanX, meanY + meanDelta * 10);
-  auto left = new PointInt(meanX - meanDelta * 5, meanY - meanDelta * 5);
-  auto right = new PointInt(meanX + meanDelta * 5, meanY - meanDelta * 5);
+  auto top = arena.points.create(meanX, meanY + meanDelta * 10);
+  auto left = arena.points.create(meanX - meanDelta * 5, meanY - meanDelta * 5);
+  auto right = arena.points.create(meanX + meanDelta * 5, meanY - meanDelta * 5);
 
-  auto face = new Face<int>();
+  auto face = arena.faces.create();
 
-  auto edge = geo::createEdgeP2P<int>(top, right, nullptr, face);
-  auto tmpEdge = geo::createEdgeP2P<int>(right, left, nullptr, face);
+  auto edge = geo::createEdgeP2P<int>(arena, top, right, nullptr, face);
+  auto tmpEdge = geo::createEdgeP2P<int>(arena, right, left, nullptr, face);
 
   // tie pointers together: first and second edges
   edge->setNext(tmpEdge);
@@ -31,7 +89,7 @@ void Delaunay::prepareTriangulation(int minX, int maxX, int minY, int maxY)
   tmpEdge->twin()->setNext(edge->twin());
 
   edge = tmpEdge;
-  tmpEdge = geo::createEdgeP2P<int>(left, top, nullptr, face);
+  tmpEdge = geo::createEdgeP2P<int>(arena, left, top, nullptr, face);
 
   // tie pointers together: second and third edges
   edge->setNext(tmpEdge);
@@ -49,17 +107,69 @@ void Delaunay::prepareTriangulation(int minX, int maxX, int minY, int maxY)
   // point to edge leaving topmost vertex
   face->setChain(tmpEdge->next());
   faces.insert(face);
+  if (!useWalk)
+    history.reset(face);
+  lastFace = face;
 
   computationPoints.push_back(top);
   computationPoints.push_back(right);
   computationPoints.push_back(left);
 }
 
+/**
+ * Reorder the points in a biased randomized insertion order.
+ * 
+ * The shuffled points are split in rounds that double in size (the last round holds half of the points)
+ * and each round is sorted along a Hilbert curve, so consecutive insertions are close to each other.
+ */
+void Delaunay::sortPoints()
+{
+  if (points.empty())
+    return;
+
+  std::shuffle(points.begin(), points.end(), rng);
+
+  int maxX = std::numeric_limits<int>::min();
+  int minX = std::numeric_limits<int>::max();
+  int maxY = std::numeric_limits<int>::min();
+  int minY = std::numeric_limits<int>::max();
+  for (auto const &p : points)
+  {
+    maxX = p->x > maxX ? p->x : maxX;
+    minX = p->x < minX ? p->x : minX;
+    maxY = p->y > maxY ? p->y : maxY;
+    minY = p->y < minY ? p->y : minY;
+  }
+  double scaleX = maxX > minX ? 65535.0 / (double(maxX) - minX) : 0.0;
+  double scaleY = maxY > minY ? 65535.0 / (double(maxY) - minY) : 0.0;
+
+  std::vector<std::pair<unsigned long long, PointInt *>> keyedPoints;
+  keyedPoints.reserve(points.size());
+  for (auto const &p : points)
+  {
+    keyedPoints.push_back({hilbertIndex(unsigned((double(p->x) - minX) * scaleX), unsigned((double(p->y) - minY) * scaleY)), p});
+  }
+
+  // rounds are [end / 2, end), the first one takes whatever is left when it gets small
+  size_t begin, end = keyedPoints.size();
+  while (end > 0)
+  {
+    begin = end > 64 ? end / 2 : 0;
+    std::sort(keyedPoints.begin() + begin, keyedPoints.begin() + end);
+    end = begin;
+  }
+
+  for (size_t i = 0; i < points.size(); i++)
+    points[i] = keyedPoints[i].second;
+}
+
 void Delaunay::triangulate()
 {
   HalfEdge<int> *edge, *tmpEdge, *newEdge1, *newEdge2;
-  Face<int> *tmpFace;
+  Face<int> *tmpFace, *tmpFace2;
+  HistoryNode<int> *node1, *node2;
   std::vector<HalfEdge<int> *> tmpEdgeVector;
+  STATS_START(triangulate);
   for (auto &p : points)
   {
     auto face = findTriangle(p, &edge);
@@ -72,9 +182,11 @@ void Delaunay::triangulate()
     // Point inside triangle
     if (edge == nullptr)
     {
-      newEdge1 = geo::createEdgeP2E(p, face->edgeChain());
+      node1 = history.leaf(face);
+
+      newEdge1 = geo::createEdgeP2E(arena, p, face->edgeChain());
       tmpEdge = face->edgeChain()->next();
-      newEdge2 = geo::createEdgeP2E(p, tmpEdge);
+      newEdge2 = geo::createEdgeP2E(arena, p, tmpEdge);
 
       newEdge1->setPrev(newEdge2->twin());
       newEdge2->twin()->setNext(newEdge1);
@@ -82,98 +194,159 @@ void Delaunay::triangulate()
 
       newEdge1 = newEdge2;
 
-      newEdge2 = geo::createEdgeP2E(p, tmpEdge->next());
+      newEdge2 = geo::createEdgeP2E(arena, p, tmpEdge->next());
 
       newEdge1->setPrev(newEdge2->twin());
       newEdge2->twin()->setNext(newEdge1);
 
-      tmpFace = new Face<int>();
+      tmpFace = arena.faces.create();
       geo::setFace(newEdge1, tmpFace);
       faces.insert(tmpFace);
 
       newEdge2->next()->next()->setNext(newEdge2);
       newEdge2->setPrev(newEdge2->next()->next());
 
-      tmpFace = new Face<int>();
-      geo::setFace(newEdge2, tmpFace);
-      faces.insert(tmpFace);
+      tmpFace2 = arena.faces.create();
+      geo::setFace(newEdge2, tmpFace2);
+      faces.insert(tmpFace2);
+
+      history.replace({node1}, {face, tmpFace, tmpFace2});
     }
     else
     {
       tmpEdge = edge->twin();
-      geo::insertPointInEdge(p, edge);
+      node1 = history.leaf(edge->face());
+      node2 = history.leaf(tmpEdge->face());
+      geo::insertPointInEdge(arena, p, edge);
 
-      tmpFace = geo::insertDiagonal(edge->prev(), edge->next());
+      tmpFace = geo::insertDiagonal(arena, edge->prev(), edge->next());
       faces.insert(tmpFace);
+      history.replace({node1}, {edge->face(), tmpFace});
 
-      tmpFace = geo::insertDiagonal(tmpEdge->prev(), tmpEdge->next());
+      tmpFace = geo::insertDiagonal(arena, tmpEdge->prev(), tmpEdge->next());
       faces.insert(tmpFace);
+      history.replace({node2}, {tmpEdge->face(), tmpFace});
     }
 
     computationPoints.push_back(p);
 
     // legalize edges
-    tmpEdgeVector = std::vector<HalfEdge<int> *>(p->incidentEdges.begin(), p->incidentEdges.end());
+    tmpEdgeVector.clear();
+    for (auto const &e : p->outgoingEdges())
+      tmpEdgeVector.push_back(e);
     for (auto &e : tmpEdgeVector)
     {
-      geo::legalizeEdge(p, e->next());
+      geo::legalizeEdge(p, e->next(), &history);
     }
+    lastFace = face;
   }
+  STATS_STOP(triangulate);
+
+  // the history refers to faces that are about to be discarded
+  history.clear();
+  lastFace = nullptr;
 
   // remove bounding vertices
+  STATS_START(removeBoundingTriangle);
   PointInt *tmpPoint;
   while (!computationPoints.empty() && computationPoints.front()->getId() < 0)
   {
     tmpPoint = computationPoints.front();
     computationPoints.pop_front();
     removeVertex(tmpPoint);
+    arena.points.destroy(tmpPoint);
+    STATS_ADD(boundingVertexRemovals, 1);
+  }
+  computationPoints.clear();
+  STATS_STOP(removeBoundingTriangle);
+
+  numberElements();
+}
+
+void Delaunay::numberElements()
+{
+  faceCount = 0;
+  for (auto const &f : faces)
+    f->setId(int(faceCount++));
+  freeFaceIds.clear();
+  freeHalfEdgeIds.clear();
+
+  halfEdgeCount = 0;
+  for (auto const &p : points)
+  {
+    for (auto const &e : p->outgoingEdges())
+      e->setId(int(halfEdgeCount++));
   }
 }
 
 /**
- * Find which triangle contains given point using barycentric coordinates.
+ * Find which triangle contains given point by descending the history DAG, or by walking from the last
+ * inserted triangle when the points were spatially sorted.
  * 
  * If the point is on an edge, [onEdge] is set to that edge.
  */
 Face<int> *Delaunay::findTriangle(PointInt *p, HalfEdge<int> **onEdge)
 {
-  double l1, l2, l3, det;
-  PointInt *p1, *p2, *p3;
-  for (auto &f : faces)
+  *onEdge = nullptr;
+  auto face = useWalk ? walkToTriangle(p, lastFace) : history.locate(*p);
+  STATS_ONLY(stats.endFindTriangle());
+  if (face == nullptr)
+    return nullptr;
+
+  auto tmpEdge = face->edgeChain();
+  do
   {
-    p1 = f->edgeChain()->from();
-    p2 = f->edgeChain()->to();
-    p3 = f->edgeChain()->prev()->from();
+    if (geo::orient2d(*tmpEdge->from(), *tmpEdge->to(), *p) == 0)
+    {
+      *onEdge = tmpEdge;
+      break;
+    }
+    tmpEdge = tmpEdge->next();
+  } while (tmpEdge != face->edgeChain());
 
-    // compute barycentric coordinates
-    det = (p2->y - p3->y) * (p1->x - p3->x) + (p3->x - p2->x) * (p1->y - p3->y);
+  return face;
+}
 
-    l1 = ((p2->y - p3->y) * (p->x - p3->x) + (p3->x - p2->x) * (p->y - p3->y)) / det;
-    l2 = ((p3->y - p1->y) * (p->x - p3->x) + (p1->x - p3->x) * (p->y - p3->y)) / det;
-    l3 = 1 - l1 - l2;
+/**
+ * Visibility walk: move to the neighbor across any edge that separates the current triangle from the point,
+ * until there is none. The first edge tested is chosen at random, so the walk cannot cycle.
+ * 
+ * Return nullptr if the walk leaves the triangulation, setting [exit] to the hull edge it crossed.
+ */
+Face<int> *Delaunay::walkToTriangle(PointInt *p, Face<int> *start, HalfEdge<int> **exit)
+{
+  int side, opposite;
+  bool moved;
+  auto face = start;
 
-    *onEdge = nullptr;
+  do
+  {
+    STATS_ADD(scan, 1);
+    moved = false;
+    auto tmpEdge = face->edgeChain();
+    for (auto i = rng() % 3; i > 0; i--)
+      tmpEdge = tmpEdge->next();
 
-    if (compareDoubleEqual(l1, 0.0))
-    {
-      *onEdge = f->edgeChain()->next();
-    }
-    else if (compareDoubleEqual(l2, 0.0))
+    for (int i = 0; i < 3 && !moved; i++)
     {
-      *onEdge = f->edgeChain()->prev();
-    }
-    else if (compareDoubleEqual(l2, 0.0))
-    {
-      *onEdge = f->edgeChain();
+      side = geo::orient2d(*tmpEdge->from(), *tmpEdge->to(), *p);
+      opposite = geo::orient2d(*tmpEdge->from(), *tmpEdge->to(), *tmpEdge->next()->to());
+      if ((side > 0 && opposite < 0) || (side < 0 && opposite > 0))
+      {
+        face = tmpEdge->twin()->face();
+        if (face == nullptr)
+        {
+          if (exit != nullptr)
+            *exit = tmpEdge;
+          return nullptr;
+        }
+        moved = true;
+      }
+      tmpEdge = tmpEdge->next();
     }
+  } while (moved);
 
-    if (l1 >= 0 && l2 >= 0 && l3 >= 0)
-    {
-      return f;
-    }
-  }
-  *onEdge = nullptr;
-  return nullptr;
+  return face;
 }
 
 void Delaunay::removeVertex(PointInt *p)
@@ -182,13 +355,15 @@ void Delaunay::removeVertex(PointInt *p)
 
   HalfEdge<int> *tmpEdge, *twin;
   Face<int> *discartedFace, *tmpFace;
-  while (!p->incidentEdges.empty())
+  while (p->outgoingEdge() != nullptr)
   {
-    tmpEdge = *(p->incidentEdges.begin());
-    p->incidentEdges.erase(p->incidentEdges.begin());
-
+    tmpEdge = p->outgoingEdge();
     twin = tmpEdge->twin();
-    twin->from()->removeIncidentEdge(twin);
+
+    // move the handles of both endpoints to the next edge of their stars, if any
+    p->setOutgoingEdge(twin->next() != tmpEdge ? twin->next() : nullptr);
+    if (twin->from()->outgoingEdge() == twin)
+      twin->from()->setOutgoingEdge(tmpEdge->next() != twin ? tmpEdge->next() : nullptr);
 
     tmpEdge->next()->setPrev(twin->prev());
     twin->prev()->setNext(tmpEdge->next());
@@ -208,10 +383,483 @@ void Delaunay::removeVertex(PointInt *p)
     }
     geo::setFace(tmpEdge->next(), tmpFace);
 
-    faces.erase(discartedFace);
-    delete discartedFace;
-    delete tmpEdge;
-    delete twin;
+    // the last edge of an interior vertex has the merged face on both sides
+    if (discartedFace != nullptr && discartedFace != tmpFace)
+    {
+      faces.erase(discartedFace);
+      arena.faces.destroy(discartedFace);
+    }
+    arena.edges.destroy(tmpEdge);
+    arena.edges.destroy(twin);
+  }
+}
+int Delaunay::newFaceId()
+{
+  if (freeFaceIds.empty())
+    return int(faceCount++);
+  int id = freeFaceIds.back();
+  freeFaceIds.pop_back();
+  return id;
+}
+
+int Delaunay::newHalfEdgeId()
+{
+  if (freeHalfEdgeIds.empty())
+    return int(halfEdgeCount++);
+  int id = freeHalfEdgeIds.back();
+  freeHalfEdgeIds.pop_back();
+  return id;
+}
+
+void Delaunay::rebuild()
+{
+  for (auto &p : points)
+    p->setOutgoingEdge(nullptr);
+  faces.clear();
+  arena.release();
+  chunkArenas.clear();
+  lastFace = nullptr;
+
+  divideAndConquer(1);
+  numberElements();
+}
+
+/**
+ * Insert a site in the triangulation:
+ * 
+ * 1. Walk from the last triangle changed to the one that contains the site
+ * 2. Split it in three, or split the two triangles of the edge the site is on, like triangulate() does. A site
+ *    outside the hull is joined to every hull edge it sees instead
+ * 3. Legalize the edges opposite to the site
+ * 
+ * Every triangle created or flipped ends up around the site, so its star is the whole change.
+ */
+DelaunayUpdate Delaunay::insert(PointInt *site)
+{
+  DelaunayUpdate update;
+
+  // without a triangle there is nothing to walk on
+  if (faces.empty())
+  {
+    for (auto const &p : points)
+    {
+      if (*p == *site)
+        return update;
+    }
+    points.push_back(site);
+    site->setId(int(points.size()));
+    rebuild();
+    update.insertedSite = site;
+    update.rebuilt = true;
+    return update;
+  }
+
+  HalfEdge<int> *edge = nullptr, *exit = nullptr, *tmpEdge;
+  auto start = lastFace != nullptr ? lastFace : *faces.begin();
+  auto face = walkToTriangle(site, start, &exit);
+  STATS_ONLY(stats.endFindTriangle());
+
+  if (face != nullptr)
+  {
+    tmpEdge = face->edgeChain();
+    do
+    {
+      if (*tmpEdge->from() == *site)
+        return update;
+      if (edge == nullptr && geo::orient2d(*tmpEdge->from(), *tmpEdge->to(), *site) == 0)
+        edge = tmpEdge;
+      tmpEdge = tmpEdge->next();
+    } while (tmpEdge != face->edgeChain());
+  }
+
+  points.push_back(site);
+  site->setId(int(points.size()));
+
+  if (face == nullptr)
+  {
+    // the hull edges that see the site are consecutive along the outer face, which has the site on its right
+    auto first = exit->twin();
+    while (geo::orient2d(*first->prev()->from(), *first->prev()->to(), *site) < 0)
+      first = first->prev();
+    std::vector<HalfEdge<int> *> visible;
+    for (auto e = first; geo::orient2d(*e->from(), *e->to(), *site) < 0; e = e->next())
+      visible.push_back(e);
+
+    HalfEdge<int> *diagonal;
+    auto spoke = geo::createEdgeP2E(arena, site, visible.front());
+    for (auto const &e : visible)
+    {
+      geo::insertDiagonal(arena, spoke, e->next(), &diagonal, false);
+      auto newFace = arena.faces.create();
+      geo::setFace(diagonal, newFace);
+      faces.insert(newFace);
+      spoke = diagonal->twin();
+      spoke->setFace(nullptr);
+    }
+  }
+  else if (edge == nullptr)
+  {
+    auto newEdge1 = geo::createEdgeP2E(arena, site, face->edgeChain());
+    tmpEdge = face->edgeChain()->next();
+    auto newEdge2 = geo::createEdgeP2E(arena, site, tmpEdge);
+
+    newEdge1->setPrev(newEdge2->twin());
+    newEdge2->twin()->setNext(newEdge1);
+    geo::setFace(newEdge1, face);
+
+    newEdge1 = newEdge2;
+    newEdge2 = geo::createEdgeP2E(arena, site, tmpEdge->next());
+
+    newEdge1->setPrev(newEdge2->twin());
+    newEdge2->twin()->setNext(newEdge1);
+
+    auto tmpFace = arena.faces.create();
+    geo::setFace(newEdge1, tmpFace);
+    faces.insert(tmpFace);
+
+    newEdge2->next()->next()->setNext(newEdge2);
+    newEdge2->setPrev(newEdge2->next()->next());
+
+    tmpFace = arena.faces.create();
+    geo::setFace(newEdge2, tmpFace);
+    faces.insert(tmpFace);
+  }
+  else
+  {
+    // on a hull edge only the inner side is split
+    tmpEdge = edge->twin();
+    geo::insertPointInEdge(arena, site, edge);
+    faces.insert(geo::insertDiagonal(arena, edge->prev(), edge->next()));
+    if (tmpEdge->face() != nullptr)
+      faces.insert(geo::insertDiagonal(arena, tmpEdge->prev(), tmpEdge->next()));
+  }
+
+  std::vector<HalfEdge<int> *> star;
+  for (auto const &e : site->outgoingEdges())
+    star.push_back(e);
+  for (auto &e : star)
+  {
+    if (e->face() != nullptr)
+      geo::legalizeEdge(site, e->next());
+  }
+
+  update.insertedSite = site;
+  update.sites.push_back(site);
+  for (auto const &e : site->outgoingEdges())
+  {
+    update.sites.push_back(e->to());
+    if (e->getId() < 0)
+    {
+      e->setId(newHalfEdgeId());
+      e->twin()->setId(newHalfEdgeId());
+    }
+    if (e->face() != nullptr)
+    {
+      update.faces.push_back(e->face());
+      if (e->face()->getId() < 0)
+        e->face()->setId(newFaceId());
+      lastFace = e->face();
+    }
+  }
+  return update;
+}
+
+/**
+ * Remove a site from the triangulation:
+ * 
+ * 1. Delete its edges, leaving a hole bounded by its neighbors (or a pocket in the hull)
+ * 2. Clip Delaunay ears from the boundary of the hole: a convex corner whose circumcircle holds no other vertex
+ *    of the boundary is a triangle of the new triangulation
+ * 
+ * The triangles that are left around the hole do not change.
+ */
+DelaunayUpdate Delaunay::remove(PointInt *site)
+{
+  DelaunayUpdate update;
+  size_t index = size_t(site->getId() - 1);
+  if (site->getId() < 1 || index >= points.size() || points[index] != site)
+    return update;
+
+  // star in counterclockwise order, starting after the outer face if the site is on the hull
+  std::vector<HalfEdge<int> *> star;
+  size_t triangles = 0, gap = 0;
+  for (auto const &e : site->outgoingEdges())
+  {
+    if (e->twin()->face() == nullptr)
+      gap = star.size() + 1;
+    if (e->face() != nullptr)
+      triangles++;
+    star.push_back(e);
   }
-  delete p;
-}
\ No newline at end of file
+  bool onHull = triangles < star.size();
+  std::rotate(star.begin(), star.begin() + (gap % std::max<size_t>(star.size(), 1)), star.end());
+
+  points[index] = points.back();
+  points[index]->setId(int(index + 1));
+  points.pop_back();
+  update.removedSite = site;
+
+  // a repeated site left out of the triangulation has nothing around it
+  if (star.empty() && !faces.empty())
+    return update;
+  if (faces.empty() || triangles == faces.size())
+  {
+    site->setOutgoingEdge(nullptr);
+    rebuild();
+    update.rebuilt = true;
+    return update;
+  }
+
+  // edge i of the chain is the side of the triangle between spokes i and i + 1 opposite to the site, and it is
+  // followed by edge i - 1 once the spokes are gone
+  std::vector<HalfEdge<int> *> chain;
+  size_t sides = onHull ? star.size() - 1 : star.size();
+  for (size_t i = sides; i-- > 0;)
+    chain.push_back(star[(i + 1) % star.size()]->next());
+
+  for (auto const &e : star)
+  {
+    update.sites.push_back(e->to());
+    freeHalfEdgeIds.push_back(e->getId());
+    freeHalfEdgeIds.push_back(e->twin()->getId());
+    if (e->face() != nullptr)
+    {
+      update.removedFaces.push_back(e->face()->getId());
+      freeFaceIds.push_back(e->face()->getId());
+    }
+  }
+  removeVertex(site);
+
+  std::vector<HalfEdge<int> *> newEdges;
+  update.faces = fillHole(chain, !onHull, newEdges);
+  for (auto const &e : newEdges)
+    e->setId(newHalfEdgeId());
+  for (auto const &f : update.faces)
+    f->setId(newFaceId());
+  lastFace = !update.faces.empty() ? update.faces.front() : *faces.begin();
+  return update;
+}
+
+/**
+ * Move the sites one after the other with moveSite. A site whose target is taken is tried again after the others,
+ * in case the site there moved away.
+ *
+ * While the sites move, change.removedFaces collects the id of every triangle touched and change.sites the
+ * vertices of those triangles. Ids are recycled along the way, so the faces are only looked up at the end, around
+ * the sites collected: a touched id that no live triangle holds anymore was removed.
+ */
+DelaunayUpdate Delaunay::moveSites(std::vector<SiteMove> const &moves)
+{
+  DelaunayUpdate change;
+  change.moved = true;
+
+  std::vector<SiteMove> blocked;
+  for (auto const &m : moves)
+  {
+    if (!moveSite(m.site, m.x, m.y, change))
+      blocked.push_back(m);
+  }
+  for (auto const &m : blocked)
+    moveSite(m.site, m.x, m.y, change);
+  if (change.rebuilt)
+    return change;
+
+  std::unordered_set<PointInt *> seen;
+  std::vector<PointInt *> sites;
+  for (auto const &s : change.sites)
+  {
+    if (seen.insert(s).second)
+      sites.push_back(s);
+  }
+  change.sites.swap(sites);
+
+  std::unordered_set<int> touched(change.removedFaces.begin(), change.removedFaces.end());
+  change.removedFaces.clear();
+  for (auto const &s : change.sites)
+  {
+    for (auto const &e : s->outgoingEdges())
+    {
+      auto face = e->face();
+      if (face != nullptr && touched.erase(face->getId()) > 0)
+        change.faces.push_back(face);
+    }
+  }
+  change.removedFaces.assign(touched.begin(), touched.end());
+  return change;
+}
+
+/**
+ * Move a site:
+ * 
+ * 1. If it is inside the hull and every triangle of its star keeps its orientation at the new position, only move
+ *    it. The star is still a triangulation, so flipping the illegal edges of its triangles (and the ones exposed
+ *    by each flip) restores the Delaunay property
+ * 2. Otherwise remove it and insert it again, then give it back its index in points
+ */
+bool Delaunay::moveSite(PointInt *site, int x, int y, DelaunayUpdate &change)
+{
+  PointInt target(x, y);
+  if (*site == target)
+    return true;
+
+  bool inStar = !faces.empty() && site->outgoingEdge() != nullptr;
+  for (auto const &e : site->outgoingEdges())
+  {
+    if (!inStar)
+      break;
+    inStar = e->face() != nullptr && geo::orient2d(target, *e->to(), *e->next()->to()) < 0;
+  }
+
+  if (inStar)
+  {
+    change.sites.push_back(site);
+    for (auto const &e : site->outgoingEdges())
+    {
+      change.sites.push_back(e->to());
+      change.removedFaces.push_back(e->face()->getId());
+    }
+
+    site->x = x;
+    site->y = y;
+    std::vector<HalfEdge<int> *> pending;
+    for (auto const &e : site->outgoingEdges())
+    {
+      pending.push_back(e);
+      pending.push_back(e->next());
+    }
+    flipToDelaunay(pending, change);
+    lastFace = site->outgoingEdge()->face();
+    return true;
+  }
+
+  // a site already at the target would make the insertion fail
+  if (!faces.empty())
+  {
+    auto face = walkToTriangle(&target, lastFace != nullptr ? lastFace : *faces.begin());
+    if (face != nullptr)
+    {
+      auto e = face->edgeChain();
+      do
+      {
+        if (*e->from() == target)
+          return false;
+        e = e->next();
+      } while (e != face->edgeChain());
+    }
+  }
+  else
+  {
+    for (auto const &p : points)
+    {
+      if (*p == target)
+        return false;
+    }
+  }
+
+  size_t index = size_t(site->getId() - 1);
+  auto removal = remove(site);
+  site->x = x;
+  site->y = y;
+  auto insertion = insert(site);
+  for (auto const *step : {&removal, &insertion})
+  {
+    change.rebuilt = change.rebuilt || step->rebuilt;
+    change.sites.insert(change.sites.end(), step->sites.begin(), step->sites.end());
+    change.removedFaces.insert(change.removedFaces.end(), step->removedFaces.begin(), step->removedFaces.end());
+    for (auto const &f : step->faces)
+      change.removedFaces.push_back(f->getId());
+  }
+
+  // insert appended the site, and remove had moved the last site to its index
+  auto last = points[index];
+  points[index] = site;
+  site->setId(int(index + 1));
+  points.back() = last;
+  last->setId(int(points.size()));
+  return true;
+}
+
+void Delaunay::flipToDelaunay(std::vector<HalfEdge<int> *> &pending, DelaunayUpdate &change)
+{
+  while (!pending.empty())
+  {
+    auto edge = pending.back();
+    pending.pop_back();
+    auto twin = edge->twin();
+    if (edge->face() == nullptr || twin->face() == nullptr)
+      continue;
+
+    // faces are clockwise, so (to, from, apex) is counterclockwise
+    if (geo::incircle(*edge->to(), *edge->from(), *edge->next()->to(), *twin->next()->to()) <= 0)
+      continue;
+    STATS_ADD(flips, 1);
+    change.sites.push_back(edge->next()->to());
+    change.sites.push_back(twin->next()->to());
+    change.removedFaces.push_back(edge->face()->getId());
+    change.removedFaces.push_back(twin->face()->getId());
+    geo::flipEdge(edge);
+    pending.push_back(edge->next());
+    pending.push_back(edge->prev());
+    pending.push_back(twin->next());
+    pending.push_back(twin->prev());
+  }
+}
+
+std::vector<Face<int> *> Delaunay::fillHole(std::vector<HalfEdge<int> *> chain, bool closed, std::vector<HalfEdge<int> *> &newEdges)
+{
+  std::vector<Face<int> *> newFaces;
+  auto rest = closed ? chain.front()->face() : nullptr;
+
+  while (chain.size() > (closed ? 3u : 1u))
+  {
+    size_t ear = chain.size();
+    size_t corners = closed ? chain.size() : chain.size() - 1;
+    for (size_t i = 0; i < corners && ear == chain.size(); i++)
+    {
+      auto a = chain[i]->from(), b = chain[i]->to(), c = chain[(i + 1) % chain.size()]->to();
+      if (geo::orient2d(*a, *b, *c) >= 0)
+        continue;
+
+      // (a, c, b) is counterclockwise
+      bool empty = true;
+      for (size_t j = 0; j <= chain.size() && empty; j++)
+      {
+        if (j == chain.size() && closed)
+          break;
+        auto v = j < chain.size() ? chain[j]->from() : chain.back()->to();
+        if (v != a && v != b && v != c && geo::incircle(*a, *c, *b, *v) > 0)
+          empty = false;
+      }
+      if (empty)
+        ear = i;
+    }
+    if (ear == chain.size())
+    {
+      if (!closed)
+        break;
+      std::cerr << "Calculations failed\n";
+      exit(-1);
+    }
+
+    HalfEdge<int> *diagonal;
+    size_t next = (ear + 1) % chain.size();
+    geo::insertDiagonal(arena, chain[ear], chain[next]->next(), &diagonal, false);
+    auto face = arena.faces.create();
+    geo::setFace(diagonal, face);
+    faces.insert(face);
+    newFaces.push_back(face);
+    newEdges.push_back(diagonal);
+    newEdges.push_back(diagonal->twin());
+    diagonal->twin()->setFace(rest);
+
+    chain[ear] = diagonal->twin();
+    chain.erase(chain.begin() + next);
+  }
+
+  if (closed)
+  {
+    geo::setFace(chain.front(), rest);
+    newFaces.push_back(rest);
+  }
+  return newFaces;
+}
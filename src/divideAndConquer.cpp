@@ -0,0 +1,806 @@
+#include "../include/delaunay.hpp"
+#include "../include/geometricFunctions.hpp"
+#include "../include/threadPool.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <unordered_set>
+
+/*
+ * The half-edges of the DCEL already form the rings of a quad-edge structure: the edges leaving a vertex, in
+ * counterclockwise order, are e, e->twin()->next(), ... So the algorithm of Guibas and Stolfi runs directly on
+ * them, with the usual operators written in terms of next, prev and twin.
+ */
+
+typedef HalfEdge<int> Edge;
+typedef std::pair<Edge *, Edge *> EdgePair;
+
+static Edge *sym(Edge *e) { return e->twin(); }
+static Edge *onext(Edge *e) { return e->twin()->next(); }
+static Edge *oprev(Edge *e) { return e->prev()->twin(); }
+static Edge *lnext(Edge *e) { return e->twin()->prev()->twin(); }
+static Edge *rprev(Edge *e) { return e->next(); }
+
+static bool ccw(PointInt const *a, PointInt const *b, PointInt const *c) { return geo::orient2d(*a, *b, *c) > 0; }
+static bool leftOf(PointInt const *p, Edge *e) { return ccw(p, e->from(), e->to()); }
+static bool rightOf(PointInt const *p, Edge *e) { return ccw(p, e->to(), e->from()); }
+
+/**
+ * Check if d is strictly inside the circle through a, b and c, given in counterclockwise order.
+ */
+static bool inCircle(PointInt const *a, PointInt const *b, PointInt const *c, PointInt const *d)
+{
+  return geo::incircle(*a, *b, *c, *d) > 0;
+}
+
+/**
+ * Edges of one chunk of the sites. Deleted edges are kept for reuse by the same chunk.
+ */
+struct ChunkStorage
+{
+  Arena<HalfEdge<int>> *arena;
+  std::vector<Edge *> spare;
+};
+
+/**
+ * Swap the rings of a and b: joins them if they are different, splits them otherwise.
+ */
+static void splice(Edge *a, Edge *b)
+{
+  Edge *x = a->twin(), *y = b->twin();
+  Edge *xNext = x->next(), *yNext = y->next();
+
+  x->setNext(yNext);
+  yNext->setPrev(x);
+  y->setNext(xNext);
+  xNext->setPrev(y);
+}
+
+/**
+ * Create an isolated edge from a to b.
+ */
+static Edge *makeEdge(ChunkStorage &storage, PointInt *a, PointInt *b)
+{
+  Edge *e, *t;
+  if (storage.spare.size() >= 2)
+  {
+    e = storage.spare.back();
+    storage.spare.pop_back();
+    t = storage.spare.back();
+    storage.spare.pop_back();
+    e->setFrom(a);
+    e->setTo(b);
+    t->setFrom(b);
+    t->setTo(a);
+  }
+  else
+  {
+    e = storage.arena->create(a, b);
+    t = storage.arena->create(b, a);
+  }
+  e->setTwin(t);
+  t->setTwin(e);
+  e->setNext(t);
+  e->setPrev(t);
+  t->setNext(e);
+  t->setPrev(e);
+
+  if (a->outgoingEdge() == nullptr)
+    a->setOutgoingEdge(e);
+  if (b->outgoingEdge() == nullptr)
+    b->setOutgoingEdge(t);
+  return e;
+}
+
+/**
+ * Connect the destination of a to the origin of b, so that both end on the left face of the new edge.
+ */
+static Edge *connect(ChunkStorage &storage, Edge *a, Edge *b)
+{
+  Edge *e = makeEdge(storage, a->to(), b->from());
+  splice(e, lnext(a));
+  splice(sym(e), b);
+  return e;
+}
+
+static void deleteEdge(ChunkStorage &storage, Edge *e)
+{
+  Edge *t = e->twin();
+  if (e->from()->outgoingEdge() == e)
+    e->from()->setOutgoingEdge(onext(e) != e ? onext(e) : nullptr);
+  if (t->from()->outgoingEdge() == t)
+    t->from()->setOutgoingEdge(onext(t) != t ? onext(t) : nullptr);
+
+  splice(e, oprev(e));
+  splice(t, oprev(t));
+  storage.spare.push_back(e);
+  storage.spare.push_back(t);
+}
+
+/**
+ * Merge two adjacent triangulations, given the counterclockwise convex hull edge leaving the rightmost vertex of
+ * the left one (ldi) and the clockwise one leaving the leftmost vertex of the right one (rdi).
+ *
+ * Return the hull edges leaving the leftmost and the rightmost vertices of the result.
+ */
+static EdgePair merge(ChunkStorage &storage, EdgePair left, EdgePair right)
+{
+  Edge *ldo = left.first, *ldi = left.second;
+  Edge *rdi = right.first, *rdo = right.second;
+
+  // lower common tangent
+  while (true)
+  {
+    if (leftOf(rdi->from(), ldi))
+      ldi = lnext(ldi);
+    else if (rightOf(ldi->from(), rdi))
+      rdi = rprev(rdi);
+    else
+      break;
+  }
+
+  Edge *basel = connect(storage, sym(rdi), ldi);
+  if (ldi->from() == ldo->from())
+    ldo = sym(basel);
+  if (rdi->from() == rdo->from())
+    rdo = basel;
+
+  // rise the bubble, deleting the edges that are no longer Delaunay
+  while (true)
+  {
+    Edge *lcand = onext(sym(basel));
+    bool lValid = rightOf(lcand->to(), basel);
+    if (lValid)
+    {
+      while (inCircle(basel->to(), basel->from(), lcand->to(), onext(lcand)->to()))
+      {
+        Edge *t = onext(lcand);
+        deleteEdge(storage, lcand);
+        lcand = t;
+      }
+    }
+
+    Edge *rcand = oprev(basel);
+    bool rValid = rightOf(rcand->to(), basel);
+    if (rValid)
+    {
+      while (inCircle(basel->to(), basel->from(), rcand->to(), oprev(rcand)->to()))
+      {
+        Edge *t = oprev(rcand);
+        deleteEdge(storage, rcand);
+        rcand = t;
+      }
+    }
+
+    if (!lValid && !rValid)
+      break;
+
+    if (!lValid || (rValid && inCircle(lcand->to(), lcand->from(), rcand->from(), rcand->to())))
+      basel = connect(storage, rcand, sym(basel));
+    else
+      basel = connect(storage, sym(basel), sym(lcand));
+  }
+
+  return EdgePair(ldo, rdo);
+}
+
+/**
+ * Triangulate the sites in [begin, end), sorted by x and then y, with at least 2 sites.
+ */
+static EdgePair triangulateRange(ChunkStorage &storage, PointInt **begin, PointInt **end)
+{
+  auto n = end - begin;
+  if (n == 2)
+  {
+    Edge *a = makeEdge(storage, begin[0], begin[1]);
+    return EdgePair(a, sym(a));
+  }
+  if (n == 3)
+  {
+    Edge *a = makeEdge(storage, begin[0], begin[1]);
+    Edge *b = makeEdge(storage, begin[1], begin[2]);
+    splice(sym(a), b);
+
+    if (ccw(begin[0], begin[1], begin[2]))
+    {
+      connect(storage, b, a);
+      return EdgePair(a, sym(b));
+    }
+    if (ccw(begin[0], begin[2], begin[1]))
+    {
+      Edge *c = connect(storage, b, a);
+      return EdgePair(sym(c), c);
+    }
+    return EdgePair(a, sym(b));
+  }
+
+  auto middle = begin + n / 2;
+  EdgePair left = triangulateRange(storage, begin, middle);
+  EdgePair right = triangulateRange(storage, middle, end);
+  return merge(storage, left, right);
+}
+
+/**
+ * Split [begin, end) in halves the same way triangulateRange does, down to the given depth.
+ */
+static void splitRange(PointInt **begin, PointInt **end, int depth, std::vector<std::pair<PointInt **, PointInt **>> &ranges)
+{
+  if (depth == 0)
+  {
+    ranges.push_back({begin, end});
+    return;
+  }
+  auto middle = begin + (end - begin) / 2;
+  splitRange(begin, middle, depth - 1, ranges);
+  splitRange(middle, end, depth - 1, ranges);
+}
+
+/**
+ * 1. Sort the sites by x and then y, skipping repeated ones
+ * 2. Split them in 2^depth chunks and triangulate each chunk on the pool
+ * 3. Merge neighbor chunks level by level, the merges of a level running concurrently
+ * 4. Create a face for each clockwise triangle. The hull is left without a face, like in triangulate()
+ * 5. Number the faces and half-edges
+ */
+void Delaunay::divideAndConquer(unsigned threads)
+{
+  std::vector<PointInt *> sorted(points.begin(), points.end());
+  std::sort(sorted.begin(), sorted.end(), [](PointInt const *a, PointInt const *b) {
+    return a->x != b->x ? a->x < b->x : a->y < b->y;
+  });
+  sorted.erase(std::unique(sorted.begin(), sorted.end(), [](PointInt const *a, PointInt const *b) {
+                 return a->x == b->x && a->y == b->y;
+               }),
+               sorted.end());
+  if (sorted.size() < 2)
+    return;
+
+  ThreadPool pool(threads);
+
+  // chunks are kept big enough for the merges to be cheap compared to the triangulation of a chunk
+  int depth = 0;
+  while ((1u << depth) < 4 * pool.size() && (sorted.size() >> (depth + 1)) >= 256)
+    depth++;
+
+  std::vector<std::pair<PointInt **, PointInt **>> ranges;
+  splitRange(sorted.data(), sorted.data() + sorted.size(), depth, ranges);
+
+  // the arenas left empty by reset are reused
+  std::vector<ChunkStorage> storage(ranges.size());
+  for (size_t i = 0; i < storage.size(); i++)
+  {
+    if (i == chunkArenas.size())
+      chunkArenas.emplace_back();
+    storage[i].arena = &chunkArenas[i];
+  }
+
+  std::vector<EdgePair> hulls(ranges.size());
+  pool.parallelFor(ranges.size(), [&](size_t i) {
+    hulls[i] = triangulateRange(storage[i], ranges[i].first, ranges[i].second);
+  });
+
+  // at each level, chunk i * 2 * step absorbs chunk i * 2 * step + step
+  for (size_t step = 1; step < ranges.size(); step *= 2)
+  {
+    pool.parallelFor(ranges.size() / (2 * step), [&](size_t i) {
+      size_t left = i * 2 * step;
+      hulls[left] = merge(storage[left], hulls[left], hulls[left + step]);
+    });
+  }
+
+  for (auto const &p : sorted)
+  {
+    for (auto const &e : p->outgoingEdges())
+    {
+      if (e->face() == nullptr && e->next()->next()->next() == e && geo::orient2d(*e->from(), *e->to(), *e->next()->to()) < 0)
+      {
+        auto face = arena.faces.create();
+        geo::setFace(e, face);
+        faces.insert(face);
+      }
+    }
+  }
+  numberElements();
+}
+
+/*
+ * Tiled engine. The sites are split in a grid of tiles, and each tile is triangulated on its own with the sites
+ * of a halo around it. A triangle of a tile is final when no site outside the tile and its halo can be in its
+ * circumcircle: then it is a triangle of the whole triangulation too. The triangles that no tile proves are
+ * found by a stitching pass over the sites left on the border of the proven ones.
+ */
+
+typedef std::array<int, 3> Triangle;
+
+namespace
+{
+  /**
+   * Tiles of tileWidth x tileHeight from (minX, minY), each one seeing the sites up to halo units around it. The
+   * last column and row reach the end of the box.
+   */
+  struct TileGrid
+  {
+    int cols, rows;
+    long long minX, minY, maxX, maxY;
+    long long tileWidth, tileHeight, halo;
+
+    int column(long double x) const
+    {
+      return int(std::max<long double>(0, std::min<long double>(cols - 1, std::floor((x - minX) / tileWidth))));
+    }
+    int row(long double y) const
+    {
+      return int(std::max<long double>(0, std::min<long double>(rows - 1, std::floor((y - minY) / tileHeight))));
+    }
+  };
+
+  /**
+   * Region of the sites a tile sees, inclusive. A side on the border of the box is open: there is no site past it.
+   */
+  struct TileRegion
+  {
+    long long minX, maxX, minY, maxY;
+    bool openLeft, openRight, openBottom, openTop;
+  };
+
+  /**
+   * What a tile proves: its final triangles, clockwise, as indices of the sorted sites, and the edges of those
+   * triangles (with the triangle on their right) whose other side the tile does not prove.
+   */
+  struct TileResult
+  {
+    std::vector<Triangle> triangles;
+    std::vector<std::pair<int, int>> border;
+  };
+}
+
+static long long edgeKey(int a, int b) { return (long long)a << 32 | (unsigned)b; }
+
+/**
+ * Check that e is a clockwise triangle of the local triangulation, not the outer face.
+ */
+static bool isTriangle(Edge *e)
+{
+  return e->next()->next()->next() == e && geo::orient2d(*e->from(), *e->to(), *e->next()->to()) < 0;
+}
+
+/**
+ * Half-edge of the triangle of e that leaves its vertex with the smallest id, which stands for the triangle.
+ */
+static Edge *triangleHandle(Edge *e)
+{
+  Edge *handle = e;
+  for (Edge *h = e->next(); h != e; h = h->next())
+  {
+    if (h->from()->getId() < handle->from()->getId())
+      handle = h;
+  }
+  return handle;
+}
+
+/**
+ * Decide if a circle through three sites is proven by the tile at (column, row): its center must be in the tile,
+ * so exactly one tile can take it, and the circle must stay clear of every site the region does not hold.
+ */
+static bool provenCircle(PointInt const *a, PointInt const *b, PointInt const *c, TileGrid const &grid, int column, int row, TileRegion const &region)
+{
+  long double bx = (long double)b->x - a->x, by = (long double)b->y - a->y;
+  long double cx = (long double)c->x - a->x, cy = (long double)c->y - a->y;
+  long double d = 2 * (bx * cy - by * cx);
+  if (d == 0)
+    return false;
+  long double b2 = bx * bx + by * by, c2 = cx * cx + cy * cy;
+  long double ux = (cy * b2 - by * c2) / d, uy = (bx * c2 - cx * b2) / d;
+  long double x = a->x + ux, y = a->y + uy, r = std::sqrt(ux * ux + uy * uy);
+  if (grid.column(x) != column || grid.row(y) != row)
+    return false;
+
+  // the sites outside the region are at least one unit past it; the margin covers the rounding of the center
+  long double const margin = 0.25;
+  return (region.openLeft || x - r > region.minX - 1 + margin) && (region.openRight || x + r < region.maxX + 1 - margin) &&
+         (region.openBottom || y - r > region.minY - 1 + margin) && (region.openTop || y + r < region.maxY + 1 - margin);
+}
+
+/**
+ * Triangulate the sites of a tile and its halo, then keep the triangles it proves.
+ *
+ * Cocircular sites make the triangulation ambiguous, and two tiles could split the same empty circle in different
+ * ways. So the triangles of an empty circle are decided together, from the three sites of the circle with the
+ * smallest indices, which every tile that sees the whole circle picks alike.
+ */
+static void triangulateTile(std::vector<PointInt *> const &sorted, std::vector<int> const &siteIndices, TileGrid const &grid, int column, int row, TileResult &result)
+{
+  TileRegion region;
+  region.minX = grid.minX + column * grid.tileWidth - grid.halo;
+  region.maxX = column == grid.cols - 1 ? grid.maxX : grid.minX + (column + 1) * grid.tileWidth - 1 + grid.halo;
+  region.minY = grid.minY + row * grid.tileHeight - grid.halo;
+  region.maxY = row == grid.rows - 1 ? grid.maxY : grid.minY + (row + 1) * grid.tileHeight - 1 + grid.halo;
+  region.openLeft = column == 0;
+  region.openRight = column == grid.cols - 1;
+  region.openBottom = row == 0;
+  region.openTop = row == grid.rows - 1;
+
+  // copies of the sites, since a site is in the halo of several tiles; their ids are the indices in sorted
+  std::vector<PointInt> local;
+  local.reserve(siteIndices.size());
+  for (auto const &i : siteIndices)
+  {
+    auto p = sorted[i];
+    if (p->x >= region.minX && p->x <= region.maxX && p->y >= region.minY && p->y <= region.maxY)
+      local.emplace_back(p->x, p->y, i);
+  }
+  if (local.size() < 3)
+    return;
+  std::vector<PointInt *> order;
+  order.reserve(local.size());
+  for (auto &p : local)
+    order.push_back(&p);
+  std::sort(order.begin(), order.end(), [](PointInt const *a, PointInt const *b) { return a->getId() < b->getId(); });
+
+  Arena<HalfEdge<int>> edges;
+  ChunkStorage storage = {&edges, {}};
+  triangulateRange(storage, order.data(), order.data() + order.size());
+
+  // handles of the proven triangles; their half-edges are marked with id 1
+  std::vector<Edge *> proven, cluster, pending;
+  auto mark = [](Edge *e, int id) {
+    e->setId(id);
+    e->next()->setId(id);
+    e->prev()->setId(id);
+  };
+
+  for (auto const &p : order)
+  {
+    for (auto const &e : p->outgoingEdges())
+    {
+      if (e->getId() != -1 || !isTriangle(e) || triangleHandle(e) != e)
+        continue;
+
+      // the triangles of the same empty circle are joined across edges with a cocircular opposite site
+      cluster.assign(1, e);
+      pending.assign(1, e);
+      mark(e, 2);
+      while (!pending.empty())
+      {
+        auto t = pending.back();
+        pending.pop_back();
+        auto h = t;
+        do
+        {
+          auto across = h->twin();
+          if (across->getId() == -1 && isTriangle(across) && geo::incircle(*h->from(), *h->to(), *h->next()->to(), *across->next()->to()) == 0)
+          {
+            auto handle = triangleHandle(across);
+            mark(handle, 2);
+            cluster.push_back(handle);
+            pending.push_back(handle);
+          }
+          h = h->next();
+        } while (h != t);
+      }
+
+      PointInt const *first[3] = {nullptr, nullptr, nullptr};
+      for (auto const &t : cluster)
+      {
+        auto h = t;
+        do
+        {
+          PointInt const *v = h->from();
+          for (auto &f : first)
+          {
+            if (f == v)
+              break;
+            if (f == nullptr || v->getId() < f->getId())
+              std::swap(f, v);
+          }
+          h = h->next();
+        } while (h != t);
+      }
+      if (!provenCircle(first[0], first[1], first[2], grid, column, row, region))
+        continue;
+      for (auto const &t : cluster)
+      {
+        mark(t, 1);
+        proven.push_back(t);
+      }
+    }
+  }
+
+  for (auto const &t : proven)
+  {
+    result.triangles.push_back({t->from()->getId(), t->to()->getId(), t->next()->to()->getId()});
+    auto h = t;
+    do
+    {
+      if (h->twin()->getId() != 1)
+        result.border.push_back({h->from()->getId(), h->to()->getId()});
+      h = h->next();
+    } while (h != t);
+  }
+}
+
+/**
+ * Add the triangles that no tile proved to the proven ones. They fill the holes between the proven ones, and every vertex of such a
+ * triangle is on the border of the proven triangles (or in none of them), so they are triangles of the
+ * triangulation of those sites. Starting from the border edges, flood the triangles of that triangulation without
+ * crossing into the proven ones.
+ *
+ * Return false if the border does not match the triangulation of its sites.
+ */
+static bool stitchTiles(std::vector<PointInt *> const &sorted, std::vector<TileResult> const &tiles, std::vector<Triangle> &triangles)
+{
+  std::unordered_set<long long> candidates;
+  for (auto const &tile : tiles)
+  {
+    for (auto const &e : tile.border)
+      candidates.insert(edgeKey(e.first, e.second));
+  }
+  std::vector<std::pair<int, int>> border;
+  std::unordered_set<long long> borderKeys;
+  for (auto const &tile : tiles)
+  {
+    for (auto const &e : tile.border)
+    {
+      if (candidates.count(edgeKey(e.second, e.first)) == 0)
+      {
+        border.push_back(e);
+        borderKeys.insert(edgeKey(e.first, e.second));
+      }
+    }
+  }
+
+  std::vector<char> stitched(sorted.size(), 1);
+  for (auto const &t : triangles)
+    stitched[t[0]] = stitched[t[1]] = stitched[t[2]] = 0;
+  for (auto const &e : border)
+    stitched[e.first] = stitched[e.second] = 1;
+
+  std::vector<PointInt> local;
+  for (size_t i = 0; i < sorted.size(); i++)
+  {
+    if (stitched[i])
+      local.emplace_back(sorted[i]->x, sorted[i]->y, int(i));
+  }
+  if (local.empty())
+    return true;
+  if (local.size() < 3)
+    return false;
+
+  // the indices follow the order of sorted, so the copies are already sorted
+  std::vector<PointInt *> order;
+  for (auto &p : local)
+    order.push_back(&p);
+  Arena<HalfEdge<int>> edges;
+  ChunkStorage storage = {&edges, {}};
+  triangulateRange(storage, order.data(), order.data() + order.size());
+
+  auto copyOf = [&](int i) {
+    auto it = std::lower_bound(order.begin(), order.end(), i, [](PointInt const *p, int i) { return p->getId() < i; });
+    return it != order.end() && (*it)->getId() == i ? *it : nullptr;
+  };
+
+  std::vector<Edge *> pending;
+  for (auto const &e : border)
+  {
+    // the missing triangle is on the right of the reverse of the border edge
+    Edge *start = nullptr;
+    for (auto const &h : copyOf(e.second)->outgoingEdges())
+    {
+      if (h->to()->getId() == e.first)
+        start = h;
+    }
+    if (start == nullptr)
+      return false;
+    if (start->getId() != -1 || !isTriangle(start))
+      continue;
+
+    pending.assign(1, start);
+    start->setId(1);
+    start->next()->setId(1);
+    start->prev()->setId(1);
+    while (!pending.empty())
+    {
+      auto t = pending.back();
+      pending.pop_back();
+      triangles.push_back({t->from()->getId(), t->to()->getId(), t->next()->to()->getId()});
+      auto h = t;
+      do
+      {
+        auto across = h->twin();
+        if (across->getId() == -1 && borderKeys.count(edgeKey(across->from()->getId(), across->to()->getId())) == 0 && isTriangle(across))
+        {
+          across->setId(1);
+          across->next()->setId(1);
+          across->prev()->setId(1);
+          pending.push_back(across);
+        }
+        h = h->next();
+      } while (h != t);
+    }
+  }
+  return true;
+}
+
+/**
+ * 1. Sort the sites by x and then y, skipping repeated ones, and bucket them by tile
+ * 2. Triangulate each tile with its halo on the pool, keeping the triangles it proves
+ * 3. Stitch the holes between the proven triangles
+ * 4. Build the DCEL from the triangles
+ *
+ * Inputs too small for more than one tile, or where the tiles prove nothing, are left to divideAndConquer.
+ */
+void Delaunay::tiledDivideAndConquer(unsigned threads, int tiles)
+{
+  std::vector<PointInt *> sorted(points.begin(), points.end());
+  std::sort(sorted.begin(), sorted.end(), [](PointInt const *a, PointInt const *b) {
+    return a->x != b->x ? a->x < b->x : a->y < b->y;
+  });
+  sorted.erase(std::unique(sorted.begin(), sorted.end(), [](PointInt const *a, PointInt const *b) {
+                 return a->x == b->x && a->y == b->y;
+               }),
+               sorted.end());
+
+  // about 2^16 sites per tile by default
+  if (tiles <= 0)
+    tiles = int(std::ceil(std::sqrt(double(sorted.size()) / (1 << 16))));
+  if (tiles <= 1 || sorted.size() < 3)
+  {
+    divideAndConquer(threads);
+    return;
+  }
+
+  TileGrid grid;
+  grid.minX = grid.minY = std::numeric_limits<long long>::max();
+  grid.maxX = grid.maxY = std::numeric_limits<long long>::min();
+  for (auto const &p : sorted)
+  {
+    grid.minX = std::min<long long>(grid.minX, p->x);
+    grid.maxX = std::max<long long>(grid.maxX, p->x);
+    grid.minY = std::min<long long>(grid.minY, p->y);
+    grid.maxY = std::max<long long>(grid.maxY, p->y);
+  }
+  grid.cols = grid.rows = tiles;
+  grid.tileWidth = std::max(1LL, (grid.maxX - grid.minX + 1) / tiles);
+  grid.tileHeight = std::max(1LL, (grid.maxY - grid.minY + 1) / tiles);
+
+  // a few times the mean distance between sites, which the circumcircles of most triangles stay within
+  double spacing = std::sqrt(double(grid.maxX - grid.minX + 1) * double(grid.maxY - grid.minY + 1) / sorted.size());
+  grid.halo = std::min(std::min(grid.tileWidth, grid.tileHeight), (long long)std::ceil(4 * spacing));
+
+  // the sites of each tile, in sorted order; a tile reads its neighbors too for its halo
+  std::vector<std::vector<int>> tileSites(size_t(tiles) * tiles);
+  for (size_t i = 0; i < sorted.size(); i++)
+    tileSites[size_t(grid.row(sorted[i]->y)) * tiles + grid.column(sorted[i]->x)].push_back(int(i));
+
+  ThreadPool pool(threads);
+  std::vector<TileResult> results(tileSites.size());
+  pool.parallelFor(tileSites.size(), [&](size_t t) {
+    int column = int(t % tiles), row = int(t / tiles);
+    std::vector<int> nearby;
+    for (int j = std::max(0, row - 1); j <= std::min(tiles - 1, row + 1); j++)
+    {
+      for (int i = std::max(0, column - 1); i <= std::min(tiles - 1, column + 1); i++)
+      {
+        auto const &s = tileSites[size_t(j) * tiles + i];
+        nearby.insert(nearby.end(), s.begin(), s.end());
+      }
+    }
+    triangulateTile(sorted, nearby, grid, column, row, results[t]);
+  });
+
+  std::vector<Triangle> triangles;
+  for (auto &r : results)
+  {
+    triangles.insert(triangles.end(), r.triangles.begin(), r.triangles.end());
+    std::vector<Triangle>().swap(r.triangles);
+  }
+  if (triangles.empty() || !stitchTiles(sorted, results, triangles) || !buildFromTriangles(sorted, triangles))
+  {
+    divideAndConquer(threads);
+    return;
+  }
+  numberElements();
+}
+
+/**
+ * Half-edge k goes from corner k % 3 of triangle k / 3 to the next corner. Twins are found among the half-edges
+ * leaving the destination, grouped by origin. The counts are checked before anything is created: each directed
+ * edge at most once, every site used, one hull edge leaving each hull vertex, and Euler's formula for a
+ * triangulated polygon.
+ */
+bool Delaunay::buildFromTriangles(std::vector<PointInt *> const &sites, std::vector<Triangle> const &triangles)
+{
+  size_t n = sites.size(), count = 3 * triangles.size(), none = std::numeric_limits<size_t>::max();
+  auto from = [&](size_t k) { return triangles[k / 3][k % 3]; };
+  auto to = [&](size_t k) { return triangles[k / 3][(k + 1) % 3]; };
+
+  std::vector<size_t> first(n + 1, 0), leaving(count);
+  for (size_t k = 0; k < count; k++)
+    first[from(k) + 1]++;
+  for (size_t i = 0; i < n; i++)
+  {
+    if (first[i + 1] == 0)
+      return false;
+    first[i + 1] += first[i];
+  }
+  {
+    std::vector<size_t> next(first.begin(), first.end() - 1);
+    for (size_t k = 0; k < count; k++)
+      leaving[next[from(k)]++] = k;
+  }
+
+  std::vector<size_t> twin(count, none), hullLeaving(n, none);
+  size_t hullEdges = 0;
+  for (size_t k = 0; k < count; k++)
+  {
+    int a = from(k), b = to(k);
+    int same = 0;
+    for (size_t i = first[a]; i < first[a + 1]; i++)
+      same += to(leaving[i]) == b;
+    if (same != 1)
+      return false;
+    for (size_t i = first[b]; i < first[b + 1]; i++)
+    {
+      if (to(leaving[i]) == a)
+        twin[k] = leaving[i];
+    }
+    if (twin[k] == none)
+    {
+      // the outer half-edge b -> a leaves b
+      if (hullLeaving[b] != none)
+        return false;
+      hullLeaving[b] = k;
+      hullEdges++;
+    }
+  }
+  if (triangles.size() + hullEdges + 2 != 2 * n)
+    return false;
+  for (size_t k = 0; k < count; k++)
+  {
+    if (twin[k] == none && hullLeaving[from(k)] == none)
+      return false;
+  }
+
+  if (chunkArenas.empty())
+    chunkArenas.emplace_back();
+  auto &edges = chunkArenas.front();
+  std::vector<HalfEdge<int> *> inner(count), outer(n, nullptr);
+  for (size_t k = 0; k < count; k++)
+    inner[k] = edges.create(sites[from(k)], sites[to(k)]);
+  for (size_t t = 0; t < triangles.size(); t++)
+  {
+    for (size_t j = 0; j < 3; j++)
+    {
+      inner[3 * t + j]->setNext(inner[3 * t + (j + 1) % 3]);
+      inner[3 * t + j]->setPrev(inner[3 * t + (j + 2) % 3]);
+    }
+    auto face = arena.faces.create();
+    geo::setFace(inner[3 * t], face);
+    faces.insert(face);
+  }
+  for (size_t k = 0; k < count; k++)
+  {
+    if (twin[k] != none)
+      inner[k]->setTwin(inner[twin[k]]);
+    else
+    {
+      auto e = edges.create(sites[to(k)], sites[from(k)]);
+      e->setTwin(inner[k]);
+      inner[k]->setTwin(e);
+      outer[to(k)] = e;
+    }
+  }
+  for (size_t k = 0; k < count; k++)
+  {
+    if (twin[k] != none)
+      continue;
+    // the outer half-edge b -> a is followed by the one leaving a
+    auto e = inner[k]->twin(), next = outer[from(k)];
+    e->setNext(next);
+    next->setPrev(e);
+  }
+  for (size_t i = 0; i < n; i++)
+    sites[i]->setOutgoingEdge(inner[leaving[first[i]]]);
+  return true;
+}
@@ -0,0 +1,428 @@
+#include "../include/fortune.hpp"
+#include "../include/geometricFunctions.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+Fortune::Fortune(std::vector<PointInt *> const &sites, double minX, double maxX, double minY, double maxY)
+    : sites(sites), minX(minX), maxX(maxX), minY(minY), maxY(maxY), beachLine(BreakpointComparison{this}), loneArc(-1)
+{
+  tolerance = 1e-9 * std::max({maxX - minX, maxY - minY, 1.0});
+
+  // sites from top to bottom, and from left to right in the same row
+  std::vector<int> order(sites.size());
+  for (size_t i = 0; i < sites.size(); i++)
+    order[i] = int(i);
+  std::sort(order.begin(), order.end(), [&](int a, int b) {
+    return sites[a]->y != sites[b]->y ? sites[a]->y > sites[b]->y : sites[a]->x < sites[b]->x;
+  });
+  order.erase(std::unique(order.begin(), order.end(), [&](int a, int b) {
+                return *sites[a] == *sites[b];
+              }),
+              order.end());
+
+  for (auto const &site : order)
+  {
+    while (!circleEvents.empty() && circleEvents.top()->y >= sites[site]->y)
+    {
+      auto event = circleEvents.top();
+      circleEvents.pop();
+      if (event->valid)
+        handleCircle(event);
+    }
+    handleSite(site);
+  }
+  while (!circleEvents.empty())
+  {
+    auto event = circleEvents.top();
+    circleEvents.pop();
+    if (event->valid)
+      handleCircle(event);
+  }
+
+  buildGraph(order.size() == 1 ? order.front() : -1);
+}
+
+/**
+ * X coordinate of the breakpoint when the sweep line is at the given height.
+ *
+ * Each arc is the parabola y = (x - fx)^2 / (2 (fy - sweep)) + (fy + sweep) / 2, and the breakpoint is the root of
+ * their difference where the left arc stops being the lowest one.
+ */
+double Fortune::breakpointX(Breakpoint const *bp, double sweep) const
+{
+  auto l = sites[bp->left], r = sites[bp->right];
+  if (l->y == r->y)
+    return (double(l->x) + r->x) / 2.0;
+  if (l->y == sweep)
+    return l->x;
+  if (r->y == sweep)
+    return r->x;
+
+  double d1 = 2.0 * (l->y - sweep);
+  double d2 = 2.0 * (r->y - sweep);
+  double dx = double(r->x) - l->x;
+
+  // in terms of u = x - l->x
+  double a = 1.0 / d1 - 1.0 / d2;
+  double b = 2.0 * dx / d2;
+  double c = -dx * dx / d2 + (double(l->y) - r->y) / 2.0;
+  double root = std::sqrt(std::max(b * b - 4.0 * a * c, 0.0));
+
+  double u;
+  if (b < 0)
+    u = (-b + root) / (2.0 * a);
+  else
+    u = b + root != 0 ? 2.0 * c / (-b - root) : 0.0;
+  return l->x + u;
+}
+
+bool Fortune::BreakpointComparison::operator()(Breakpoint const *a, Breakpoint const *b) const
+{
+  if (a == b)
+    return false;
+
+  double xa = owner->breakpointX(a, owner->sweepY);
+  double xb = owner->breakpointX(b, owner->sweepY);
+  if (std::fabs(xa - xb) > owner->tolerance)
+    return xa < xb;
+
+  // coincident breakpoints are the two sides of an arc that was just created or that is about to vanish
+  bool aFirst = a->right == b->left;
+  bool bFirst = b->right == a->left;
+  if (aFirst != bFirst)
+    return aFirst;
+
+  // the two breakpoints of a new arc separate as soon as the sweep line moves
+  xa = owner->breakpointX(a, owner->sweepY - owner->tolerance);
+  xb = owner->breakpointX(b, owner->sweepY - owner->tolerance);
+  if (xa != xb)
+    return xa < xb;
+  return a < b;
+}
+
+bool Fortune::BreakpointComparison::operator()(Breakpoint const *a, double x) const
+{
+  return owner->breakpointX(a, owner->sweepY) < x;
+}
+
+bool Fortune::BreakpointComparison::operator()(double x, Breakpoint const *b) const
+{
+  return x < owner->breakpointX(b, owner->sweepY);
+}
+
+int Fortune::createEdge(int site1, int site2)
+{
+  edges.push_back({site1, site2, {-1, -1}, {PointDouble(), PointDouble()}});
+  return int(edges.size()) - 1;
+}
+
+Fortune::Breakpoint *Fortune::createBreakpoint(int left, int right, int edge, int end, BeachLine::iterator hint)
+{
+  breakpoints.push_back({left, right, edge, end, nullptr, beachLine.end()});
+  auto bp = &breakpoints.back();
+
+  // the breakpoint moves along the bisector, leaving the left site on its left
+  auto l = sites[left], r = sites[right];
+  edges[edge].direction[end] = PointDouble(double(r->y) - l->y, double(l->x) - r->x);
+
+  bp->position = beachLine.insert(hint, bp);
+  return bp;
+}
+
+/**
+ * Queue the circle event of the arc at the right of the breakpoint, if its neighbors converge.
+ */
+void Fortune::checkCircle(Breakpoint *left)
+{
+  auto next = std::next(left->position);
+  if (next == beachLine.end())
+    return;
+
+  int a = left->left, b = left->right, c = (*next)->right;
+  if (a == c || geo::orient2d(*sites[a], *sites[b], *sites[c]) >= 0)
+    return;
+
+  auto center = geo::computeCircuncenter(PointDouble(*sites[a]), PointDouble(*sites[b]), PointDouble(*sites[c]));
+  double radius = geo::computeDistance(center, PointDouble(*sites[b]));
+
+  events.push_back({center.y - radius, center, left, true});
+  left->event = &events.back();
+  circleEvents.push(left->event);
+}
+
+void Fortune::discardCircle(Breakpoint *left)
+{
+  if (left->event != nullptr)
+  {
+    left->event->valid = false;
+    left->event = nullptr;
+  }
+}
+
+/**
+ * Split the arc above the site. While the sweep line is still on the first row, the arcs are vertical rays and
+ * the new site only adds one breakpoint at the right end of the beach line.
+ */
+void Fortune::handleSite(int site)
+{
+  auto s = sites[site];
+  sweepY = s->y;
+
+  if (beachLine.empty() && loneArc < 0)
+  {
+    loneArc = site;
+    return;
+  }
+
+  int arc;
+  auto next = beachLine.end();
+  if (beachLine.empty())
+    arc = loneArc;
+  else
+  {
+    next = beachLine.lower_bound(double(s->x));
+    arc = next != beachLine.end() ? (*next)->left : (*std::prev(next))->right;
+  }
+
+  if (sites[arc]->y == s->y)
+  {
+    int edge = createEdge(arc, site);
+    edges[edge].direction[1] = PointDouble(0, 1);
+    createBreakpoint(arc, site, edge, 0, next);
+    return;
+  }
+
+  Breakpoint *left = next != beachLine.begin() ? *std::prev(next) : nullptr;
+  if (left != nullptr)
+    discardCircle(left);
+
+  int edge = createEdge(arc, site);
+  createBreakpoint(arc, site, edge, 0, next);
+  auto right = createBreakpoint(site, arc, edge, 1, next);
+
+  if (left != nullptr)
+    checkCircle(left);
+  checkCircle(right);
+}
+
+/**
+ * The arc between the breakpoints of the event vanishes: both edges end at the center of the circle and a new
+ * edge starts there, between the neighbors of the arc.
+ */
+void Fortune::handleCircle(CircleEvent *event)
+{
+  sweepY = event->y;
+
+  auto left = event->left;
+  auto rightPosition = std::next(left->position);
+  auto right = *rightPosition;
+  auto next = std::next(rightPosition);
+  Breakpoint *previous = left->position != beachLine.begin() ? *std::prev(left->position) : nullptr;
+
+  int vertex = int(vertices.size());
+  vertices.push_back(event->center);
+  edges[left->edge].vertex[left->end] = vertex;
+  edges[right->edge].vertex[right->end] = vertex;
+
+  if (previous != nullptr)
+    discardCircle(previous);
+  discardCircle(left);
+  discardCircle(right);
+  beachLine.erase(left->position);
+  beachLine.erase(rightPosition);
+
+  int edge = createEdge(left->left, right->right);
+  edges[edge].vertex[0] = vertex;
+  auto bp = createBreakpoint(left->left, right->right, edge, 1, next);
+
+  if (previous != nullptr)
+    checkCircle(previous);
+  checkCircle(bp);
+}
+
+/**
+ * Liang-Barsky clipping of p + t * d, t in [t0, t1], against the box. Return false if nothing is left.
+ */
+static bool clipLine(PointDouble const &p, PointDouble const &d, double &t0, double &t1, double minX, double maxX, double minY, double maxY)
+{
+  double den[4] = {-d.x, d.x, -d.y, d.y};
+  double num[4] = {p.x - minX, maxX - p.x, p.y - minY, maxY - p.y};
+
+  for (int i = 0; i < 4; i++)
+  {
+    if (den[i] == 0)
+    {
+      if (num[i] < 0)
+        return false;
+    }
+    else if (den[i] < 0)
+      t0 = std::max(t0, num[i] / den[i]);
+    else
+      t1 = std::min(t1, num[i] / den[i]);
+  }
+  return t0 <= t1;
+}
+
+static int findRoot(std::vector<int> &parent, int v)
+{
+  while (parent[v] != v)
+  {
+    parent[v] = parent[parent[v]];
+    v = parent[v];
+  }
+  return v;
+}
+
+/**
+ * 1. Clip every traced edge to the box. Ends close enough to a side are moved onto it
+ * 2. Merge the ends that are closer than the tolerance, which also removes zero-length edges
+ * 3. Sort the vertices on each side of the box, clockwise, and link them with box edges
+ *
+ * A single site has no Voronoi edge, so its cell is the box alone.
+ */
+void Fortune::buildGraph(int loneSite)
+{
+  std::vector<PointDouble> points;
+  std::vector<int> parent;
+  std::vector<VoronoiGraph::Edge> segments;
+  std::vector<int> vertexMap(vertices.size(), -1);
+  double infinity = std::numeric_limits<double>::infinity();
+
+  auto addPoint = [&](PointDouble p) {
+    p.x = std::min(std::max(p.x, minX), maxX);
+    p.y = std::min(std::max(p.y, minY), maxY);
+    if (std::fabs(p.x - minX) <= tolerance)
+      p.x = minX;
+    if (std::fabs(p.x - maxX) <= tolerance)
+      p.x = maxX;
+    if (std::fabs(p.y - minY) <= tolerance)
+      p.y = minY;
+    if (std::fabs(p.y - maxY) <= tolerance)
+      p.y = maxY;
+    points.push_back(p);
+    parent.push_back(int(parent.size()));
+    return int(points.size()) - 1;
+  };
+  auto merge = [&](int a, int b) {
+    parent[findRoot(parent, a)] = findRoot(parent, b);
+  };
+
+  for (auto const &e : edges)
+  {
+    PointDouble origin, direction;
+    int originVertex = -1, endVertex = -1;
+    double t0 = 0, t1 = infinity;
+
+    if (e.vertex[0] >= 0 && e.vertex[1] >= 0)
+    {
+      originVertex = e.vertex[0];
+      endVertex = e.vertex[1];
+      origin = vertices[originVertex];
+      direction = PointDouble(vertices[endVertex].x - origin.x, vertices[endVertex].y - origin.y);
+      t1 = 1;
+    }
+    else if (e.vertex[0] >= 0 || e.vertex[1] >= 0)
+    {
+      int end = e.vertex[0] >= 0 ? 0 : 1;
+      originVertex = e.vertex[end];
+      origin = vertices[originVertex];
+      direction = e.direction[1 - end];
+    }
+    else
+    {
+      auto s1 = sites[e.site1], s2 = sites[e.site2];
+      origin = PointDouble((double(s1->x) + s2->x) / 2.0, (double(s1->y) + s2->y) / 2.0);
+      direction = e.direction[1];
+      t0 = -infinity;
+    }
+
+    double clip0 = t0, clip1 = t1;
+    if (!clipLine(origin, direction, clip0, clip1, minX, maxX, minY, maxY))
+      continue;
+
+    int from, to;
+    if (clip0 == t0 && originVertex >= 0)
+    {
+      if (vertexMap[originVertex] < 0)
+        vertexMap[originVertex] = addPoint(origin);
+      from = vertexMap[originVertex];
+    }
+    else
+      from = addPoint(PointDouble(origin.x + direction.x * clip0, origin.y + direction.y * clip0));
+
+    if (clip1 == t1 && endVertex >= 0)
+    {
+      if (vertexMap[endVertex] < 0)
+        vertexMap[endVertex] = addPoint(vertices[endVertex]);
+      to = vertexMap[endVertex];
+    }
+    else
+      to = addPoint(PointDouble(origin.x + direction.x * clip1, origin.y + direction.y * clip1));
+
+    if (geo::computeDistance(points[from], points[to]) <= tolerance)
+      merge(from, to);
+    else
+      segments.push_back({from, to, e.site1, e.site2});
+  }
+
+  // box vertices, in clockwise order starting from the top right corner
+  addPoint(PointDouble(maxX, maxY));
+  addPoint(PointDouble(maxX, minY));
+  addPoint(PointDouble(minX, minY));
+  addPoint(PointDouble(minX, maxY));
+  std::vector<std::pair<double, int>> sides[4];
+  for (int i = 0; i < int(points.size()); i++)
+  {
+    auto const &p = points[i];
+    if (p.x == maxX)
+      sides[0].push_back({-p.y, i});
+    if (p.y == minY)
+      sides[1].push_back({-p.x, i});
+    if (p.x == minX)
+      sides[2].push_back({p.y, i});
+    if (p.y == maxY)
+      sides[3].push_back({p.x, i});
+  }
+  for (int s = 0; s < 4; s++)
+  {
+    auto &side = sides[s];
+    std::sort(side.begin(), side.end());
+    for (size_t i = 1; i < side.size(); i++)
+    {
+      if (side[i].first - side[i - 1].first <= tolerance)
+        merge(side[i].second, side[i - 1].second);
+    }
+    for (size_t i = 1; i < side.size(); i++)
+    {
+      int a = findRoot(parent, side[i - 1].second), b = findRoot(parent, side[i].second);
+      if (a != b)
+        segments.push_back({a, b, -1, -1});
+    }
+  }
+
+  // keep only the representatives of the merged vertices
+  std::vector<int> index(points.size(), -1);
+  for (auto &s : segments)
+  {
+    s.from = findRoot(parent, s.from);
+    s.to = findRoot(parent, s.to);
+    if (s.from == s.to)
+      continue;
+    for (auto v : {s.from, s.to})
+    {
+      if (index[v] < 0)
+      {
+        index[v] = int(graph.vertices.size());
+        graph.vertices.push_back(points[v]);
+      }
+    }
+    graph.edges.push_back({index[s.from], index[s.to], s.site1, s.site2});
+  }
+
+  if (loneSite >= 0)
+  {
+    for (auto &e : graph.edges)
+      e.site1 = e.site2 = loneSite;
+  }
+}
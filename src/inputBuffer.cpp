@@ -0,0 +1,36 @@
+#include "../include/inputBuffer.hpp"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+InputBuffer::InputBuffer() : mapped(nullptr), length(0)
+{
+  struct stat info;
+  if (fstat(STDIN_FILENO, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0)
+  {
+    void *address = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, STDIN_FILENO, 0);
+    if (address != MAP_FAILED)
+    {
+      madvise(address, info.st_size, MADV_SEQUENTIAL);
+      mapped = static_cast<char const *>(address);
+      length = info.st_size;
+      return;
+    }
+  }
+
+  size_t const blockSize = 1 << 20;
+  ssize_t count;
+  do
+  {
+    buffer.resize(buffer.size() + blockSize);
+    count = read(STDIN_FILENO, &buffer[buffer.size() - blockSize], blockSize);
+    buffer.resize(buffer.size() - blockSize + (count > 0 ? count : 0));
+  } while (count > 0);
+  length = buffer.size();
+}
+
+InputBuffer::~InputBuffer()
+{
+  if (mapped != nullptr)
+    munmap(const_cast<char *>(mapped), length);
+}
@@ -1,40 +1,326 @@
 #include "../include/ioFunctions.hpp"
 #include "../include/utils.hpp"
+#include "../include/threadPool.hpp"
+#include "../include/bufferedWriter.hpp"
+#include "../include/inputBuffer.hpp"
 #include <iostream>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <unordered_map>
 #include <stdio.h>
 #include <algorithm>
+#include <charconv>
+#include <limits>
+#include <memory>
 
-void readPoints(std::vector<PointInt *> &sites)
+/**
+ * Parse the integers of [begin, end) into values. Return false if something else is found.
+ */
+static bool parseIntegers(char const *begin, char const *end, std::vector<int> &values)
 {
-  int n, x, y;
-  std::cin >> n;
+  int value;
+  while (true)
+  {
+    while (begin < end && isBlank(*begin))
+      begin++;
+    if (begin == end)
+      return true;
+    auto result = std::from_chars(begin, end, value);
+    if (result.ec != std::errc() || (result.ptr < end && !isBlank(*result.ptr)))
+      return false;
+    values.push_back(value);
+    begin = result.ptr;
+  }
+}
+
+static void invalidInput(char const *reason)
+{
+  std::cerr << "Invalid input: " << reason << "\n";
+  exit(-1);
+}
+
+void readPoints(std::vector<PointInt> &storage, std::vector<PointInt *> &sites, unsigned threads)
+{
+  InputBuffer input;
+  char const *begin = input.begin(), *end = input.end();
 
-  for (int i = 1; i <= n; i++)
+  long long n;
+  while (begin < end && isBlank(*begin))
+    begin++;
+  auto header = std::from_chars(begin, end, n);
+  if (header.ec != std::errc() || n < 0 || n > std::numeric_limits<int>::max())
+    invalidInput("the first value must be the number of sites");
+  begin = header.ptr;
+
+  // Large inputs are parsed in chunks, each one cut after a blank so no number is split
+  size_t const chunkSize = 1 << 24;
+  std::vector<std::pair<char const *, char const *>> chunks;
+  while (begin < end)
+  {
+    char const *cut = end - begin > ptrdiff_t(chunkSize) ? begin + chunkSize : end;
+    while (cut < end && !isBlank(*cut))
+      cut++;
+    chunks.push_back({begin, cut});
+    begin = cut;
+  }
+
+  std::vector<std::vector<int>> values(chunks.size());
+  std::vector<char> valid(chunks.size(), true);
+  auto parseChunk = [&](size_t i) {
+    values[i].reserve((chunks[i].second - chunks[i].first) / 4);
+    valid[i] = parseIntegers(chunks[i].first, chunks[i].second, values[i]);
+  };
+  if (chunks.size() > 1 && threads != 1)
   {
-    std::cin >> x >> y;
-    sites.push_back(new PointInt(x, y, i));
+    ThreadPool pool(threads);
+    pool.parallelFor(chunks.size(), parseChunk);
   }
+  else
+  {
+    for (size_t i = 0; i < chunks.size(); i++)
+      parseChunk(i);
+  }
+
+  size_t count = 0;
+  for (size_t i = 0; i < chunks.size(); i++)
+  {
+    if (!valid[i])
+      invalidInput("coordinates must be integers");
+    count += values[i].size();
+  }
+  if (count < 2 * size_t(n))
+  {
+    std::cerr << "Invalid input: expected " << n << " sites, found " << count / 2 << "\n";
+    exit(-1);
+  }
+
+  // values after the n sites are ignored
+  storage.clear();
+  storage.reserve(n);
+  sites.clear();
+  sites.reserve(n);
+  int coordinate[2], filled = 0;
+  for (auto const &chunk : values)
+  {
+    for (auto v : chunk)
+    {
+      if (storage.size() == size_t(n))
+        break;
+      coordinate[filled++] = v;
+      if (filled == 2)
+      {
+        storage.emplace_back(coordinate[0], coordinate[1], int(storage.size()) + 1);
+        filled = 0;
+      }
+    }
+  }
+  for (auto &p : storage)
+    sites.push_back(&p);
 }
 
-void printDelaunay(Delaunay const &del)
+std::string parseSites(char const *begin, char const *end, std::vector<PointInt> &storage, std::vector<PointInt *> &sites)
 {
-  std::vector<HalfEdge<int> *> edges;
-  std::cout << del.computationPoints.size() << "\n";
-  for (auto const &p : del.computationPoints)
+  long long n;
+  while (begin < end && isBlank(*begin))
+    begin++;
+  auto header = std::from_chars(begin, end, n);
+  if (header.ec != std::errc() || n < 0 || n > std::numeric_limits<int>::max())
+    return "the first value must be the number of sites";
+
+  storage.clear();
+  sites.clear();
+  int coordinate[2], filled = 0, value;
+  begin = header.ptr;
+  while (storage.size() < size_t(n))
   {
-    std::cout << p->getId() << " " << p->x << " " << p->y << "\n";
-    for (auto const &e : p->incidentEdges)
+    while (begin < end && isBlank(*begin))
+      begin++;
+    if (begin == end)
+      return "expected " + std::to_string(n) + " sites, found " + std::to_string(storage.size());
+    auto result = std::from_chars(begin, end, value);
+    if (result.ec != std::errc() || (result.ptr < end && !isBlank(*result.ptr)))
+      return "coordinates must be integers";
+    begin = result.ptr;
+    coordinate[filled++] = value;
+    if (filled == 2)
     {
-      edges.push_back(e);
+      storage.emplace_back(coordinate[0], coordinate[1], int(storage.size()) + 1);
+      filled = 0;
     }
   }
+  for (auto &p : storage)
+    sites.push_back(&p);
+  return "";
+}
 
-  std::cout << edges.size() << "\n";
+void applyUpdates(char const *path, Delaunay &del, Voronoi &vor, std::deque<PointInt> &storage)
+{
+  std::ifstream in(path);
+  if (!in)
+  {
+    std::cerr << "Could not open " << path << "\n";
+    exit(-1);
+  }
+
+  auto key = [](long long x, long long y) { return (x << 32) ^ (y & 0xffffffffLL); };
+  std::unordered_map<long long, PointInt *> siteAt;
+  for (auto const &p : del.points)
+    siteAt[key(p->x, p->y)] = p;
+
+  char op;
+  int x, y, line = 0;
+  while (in >> op)
+  {
+    line++;
+    if (!(in >> x >> y) || (op != '+' && op != '-'))
+    {
+      std::cerr << "Invalid update at line " << line << "\n";
+      exit(-1);
+    }
+
+    auto &site = siteAt[key(x, y)];
+    if (op == '+')
+    {
+      if (site != nullptr)
+        continue;
+      storage.emplace_back(x, y);
+      site = &storage.back();
+      vor.update(del, del.insert(site));
+    }
+    else
+    {
+      if (site == nullptr)
+      {
+        std::cerr << "Invalid update at line " << line << ": no site at (" << x << "," << y << ")\n";
+        exit(-1);
+      }
+      vor.update(del, del.remove(site));
+      site = nullptr;
+    }
+  }
+}
+
+bool readFrame(std::istream &in, Delaunay const &del, std::vector<SiteMove> &moves)
+{
+  long long n;
+  if (!(in >> n))
+  {
+    if (in.eof())
+      return false;
+    std::cerr << "Invalid frame: the first value must be the number of sites\n";
+    exit(-1);
+  }
+  if (n != (long long)del.points.size())
+  {
+    std::cerr << "Invalid frame: expected " << del.points.size() << " sites, found " << n << "\n";
+    exit(-1);
+  }
 
-  for (auto const &e : edges)
+  moves.clear();
+  int x, y;
+  for (auto const &site : del.points)
   {
-    std::cout << e->from()->getId() << " " << e->to()->getId() << "\n";
+    if (!(in >> x >> y))
+    {
+      std::cerr << "Invalid frame: expected " << n << " sites\n";
+      exit(-1);
+    }
+    if (x != site->x || y != site->y)
+      moves.push_back({site, x, y});
   }
+  return true;
+}
+
+void readQueries(char const *path, std::vector<PointDouble> &queries)
+{
+  std::ifstream in(path, std::ios::binary);
+  if (!in)
+  {
+    std::cerr << "Could not open " << path << "\n";
+    exit(-1);
+  }
+  std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  char const *begin = text.data(), *end = text.data() + text.size();
+
+  // the count, then pairs of coordinates
+  auto next = [&](double &value) {
+    while (begin < end && isBlank(*begin))
+      begin++;
+    auto result = std::from_chars(begin, end, value);
+    if (result.ec != std::errc() || (result.ptr < end && !isBlank(*result.ptr)))
+      return false;
+    begin = result.ptr;
+    return true;
+  };
+  double n;
+  if (!next(n) || n < 0 || n != double((long long)n))
+  {
+    std::cerr << "Invalid queries: the first value must be the number of points\n";
+    exit(-1);
+  }
+
+  queries.clear();
+  queries.reserve(size_t(n));
+  double x, y;
+  while (queries.size() < size_t(n))
+  {
+    if (!next(x) || !next(y))
+    {
+      std::cerr << "Invalid queries: expected " << (long long)n << " points, found " << queries.size() << "\n";
+      exit(-1);
+    }
+    queries.emplace_back(x, y);
+  }
+}
+
+/**
+ * Pool for formatting the output in parallel, or nullptr if one thread is asked for.
+ */
+static std::unique_ptr<ThreadPool> outputPool(unsigned threads)
+{
+  if (threads == 1)
+    return nullptr;
+  return std::unique_ptr<ThreadPool>(new ThreadPool(threads));
+}
+
+void printDelaunay(Delaunay const &del, unsigned threads)
+{
+  BufferedWriter out(&std::cout);
+  auto pool = outputPool(threads);
+  writeDelaunay(del, out, pool.get());
+}
+
+void writeDelaunay(Delaunay const &del, BufferedWriter &out, ThreadPool *pool)
+{
+  auto const &points = del.points;
+  std::vector<HalfEdge<int> *> edges;
+  for (auto const &p : points)
+  {
+    for (auto const &e : p->outgoingEdges())
+    {
+      edges.push_back(e);
+    }
+  }
+
+  out << points.size() << "\n";
+  out.formatLines(points.size(), pool, [&](size_t i, BufferedWriter &line) {
+    line << points[i]->getId() << ' ' << points[i]->x << ' ' << points[i]->y << '\n';
+  });
+
+  out << edges.size() << "\n";
+  out.formatLines(edges.size(), pool, [&](size_t i, BufferedWriter &line) {
+    line << edges[i]->from()->getId() << ' ' << edges[i]->to()->getId() << '\n';
+  });
+}
+
+void printSiteIds(std::vector<int> const &ids, unsigned threads)
+{
+  BufferedWriter out(&std::cout);
+  auto pool = outputPool(threads);
+  out.formatLines(ids.size(), pool.get(), [&](size_t i, BufferedWriter &line) {
+    line << ids[i] << '\n';
+  });
 }
 
 void delaunayDebug(Delaunay const &del)
@@ -59,36 +345,32 @@ void delaunayDebug(Delaunay const &del)
   }
 }
 
-bool _sortPointsById(PointDouble *a, PointDouble *b)
+void printVoronoi(Voronoi const &vor, unsigned threads)
 {
-  return a->getId() < b->getId();
+  BufferedWriter out(&std::cout);
+  auto pool = outputPool(threads);
+  writeVoronoi(vor, out, pool.get());
 }
 
-bool _sortEdgesById(HalfEdge<double> *a, HalfEdge<double> *b)
-{
-  return a->getId() < b->getId();
-}
-
-bool _sortFacesById(Face<double> *a, Face<double> *b)
-{
-  return a->getId() < b->getId();
-}
-
-void printVoronoi(Voronoi const &vor)
+void writeVoronoi(Voronoi const &vor, BufferedWriter &out, ThreadPool *pool)
 {
   int edgeCount = 0;
   int vertexCount = 0;
   int faceCount = 0;
 
+  // Vertices and half-edges are numbered in the order they are listed, so the lists are already sorted by id
   std::vector<PointDouble *> pointsVector;
   std::vector<HalfEdge<double> *> edgesVector;
   std::vector<Face<double> *> facesVector;
 
+  // face ids index vor.siteFaceReference, so the output numbers are kept apart
+  std::vector<int> faceNumber(vor.diagramFaces.size(), 0);
+
   for (auto &p : vor.diagramVertices)
   {
     p->setId(++vertexCount);
     pointsVector.push_back(p);
-    for (auto &e : p->incidentEdges)
+    for (auto const &e : p->outgoingEdges())
     {
       e->setId(++edgeCount);
       edgesVector.push_back(e);
@@ -96,32 +378,105 @@ void printVoronoi(Voronoi const &vor)
   }
   for (auto &f : vor.diagramFaces)
   {
-    if (vor.siteFaceReference.count(f) > 0)
+    if (vor.siteFaceReference[f->getId()] != nullptr)
     {
-      f->setId(++faceCount);
+      faceNumber[f->getId()] = ++faceCount;
       facesVector.push_back(f);
     }
   }
 
-  std::sort(pointsVector.begin(), pointsVector.end(), _sortPointsById);
-  std::sort(edgesVector.begin(), edgesVector.end(), _sortEdgesById);
-  std::sort(facesVector.begin(), facesVector.end(), _sortFacesById);
+  out << pointsVector.size() << ' ' << edgesVector.size() / 2 << ' ' << facesVector.size() << '\n';
+
+  out.formatLines(pointsVector.size(), pool, [&](size_t i, BufferedWriter &line) {
+    auto p = pointsVector[i];
+    line << p->x << ' ' << p->y << ' ' << p->outgoingEdge()->getId() << '\n';
+  });
+  out.formatLines(facesVector.size(), pool, [&](size_t i, BufferedWriter &line) {
+    auto f = facesVector[i];
+    auto site = vor.siteFaceReference[f->getId()];
+    line << site->x << ' ' << site->y << ' ' << f->edgeChain()->getId() << '\n';
+  });
+  out.formatLines(edgesVector.size(), pool, [&](size_t i, BufferedWriter &line) {
+    auto e = edgesVector[i];
+    line << e->from()->getId() << ' ' << e->twin()->getId() << ' ';
+    line << (e->face() != nullptr ? faceNumber[e->face()->getId()] : 0) << ' ';
+    line << e->next()->getId() << ' ' << e->prev()->getId() << '\n';
+  });
+}
+
+void printDelaunay(CompactDcel<int> const &dcel, unsigned threads)
+{
+  BufferedWriter out(&std::cout);
+  auto pool = outputPool(threads);
+
+  out << dcel.numVertices() << '\n';
+  out.formatLines(dcel.numVertices(), pool.get(), [&](size_t v, BufferedWriter &line) {
+    line << dcel.vertexId[v] << ' ' << dcel.x[v] << ' ' << dcel.y[v] << '\n';
+  });
+
+  out << dcel.edgeOrder.size() << '\n';
+  out.formatLines(dcel.edgeOrder.size(), pool.get(), [&](size_t i, BufferedWriter &line) {
+    auto e = dcel.edgeOrder[i];
+    line << dcel.vertexId[dcel.origin[e]] << ' ' << dcel.vertexId[dcel.target(e)] << '\n';
+  });
+}
 
-  std::cout << pointsVector.size() << " " << edgesVector.size() / 2 << " " << facesVector.size() << "\n";
+void printVoronoi(CompactDcel<double> const &dcel, unsigned threads)
+{
+  int faceCount = 0;
+  std::vector<int> edgeIds(dcel.numHalfEdges(), 0);
+  std::vector<int> faceIds(dcel.numFaces(), -1);
+  std::vector<uint32_t> siteFaces;
 
-  for (auto &p : pointsVector)
-    std::cout << p->x << " " << p->y << " " << (*p->incidentEdges.begin())->getId() << "\n";
-  for (auto &f : facesVector)
-    std::cout << vor.siteFaceReference.at(f)->x << " " << vor.siteFaceReference.at(f)->y << " " << f->edgeChain()->getId() << "\n";
-  for (auto &e : edgesVector)
+  for (size_t i = 0; i < dcel.edgeOrder.size(); i++)
+    edgeIds[dcel.edgeOrder[i]] = i + 1;
+  for (uint32_t f = 0; f < dcel.numFaces(); f++)
   {
-    std::cout << e->from()->getId() << " ";
-    std::cout << e->twin()->getId() << " ";
-    if (e->face() != nullptr)
-      std::cout << e->face()->getId() << " ";
-    else
-      std::cout << "0 ";
-    std::cout << e->next()->getId() << " ";
-    std::cout << e->prev()->getId() << "\n";
+    if (dcel.siteId[f] >= 0)
+    {
+      faceIds[f] = ++faceCount;
+      siteFaces.push_back(f);
+    }
   }
-}
\ No newline at end of file
+
+  BufferedWriter out(&std::cout);
+  auto pool = outputPool(threads);
+
+  out << dcel.numVertices() << ' ' << dcel.edgeOrder.size() / 2 << ' ' << faceCount << '\n';
+
+  out.formatLines(dcel.numVertices(), pool.get(), [&](size_t v, BufferedWriter &line) {
+    line << dcel.x[v] << ' ' << dcel.y[v] << ' ' << (dcel.vertexEdge[v] != dcel.none ? edgeIds[dcel.vertexEdge[v]] : 0) << '\n';
+  });
+  out.formatLines(siteFaces.size(), pool.get(), [&](size_t i, BufferedWriter &line) {
+    auto f = siteFaces[i];
+    line << dcel.siteX[f] << ' ' << dcel.siteY[f] << ' ' << edgeIds[dcel.faceEdge[f]] << '\n';
+  });
+  out.formatLines(dcel.edgeOrder.size(), pool.get(), [&](size_t i, BufferedWriter &line) {
+    auto e = dcel.edgeOrder[i];
+    line << dcel.origin[e] + 1 << ' ' << edgeIds[dcel.twin(e)] << ' ';
+    line << (dcel.face[e] != dcel.none ? faceIds[dcel.face[e]] : 0) << ' ';
+    line << edgeIds[dcel.next[e]] << ' ' << edgeIds[dcel.prev[e]] << '\n';
+  });
+}
+
+void printVoronoi(BinaryDcel const &dcel, unsigned threads)
+{
+  BufferedWriter out(&std::cout);
+  auto pool = outputPool(threads);
+
+  out << dcel.numVertices() << ' ' << dcel.numHalfEdges() / 2 << ' ' << dcel.numFaces() << '\n';
+
+  // text ids start from 1, with 0 for nothing
+  auto id = [](uint32_t index) { return index != binary::none ? index + 1 : 0; };
+  out.formatLines(dcel.numVertices(), pool.get(), [&](size_t v, BufferedWriter &line) {
+    line << dcel.x[v] << ' ' << dcel.y[v] << ' ' << id(dcel.vertexEdge[v]) << '\n';
+  });
+  out.formatLines(dcel.numFaces(), pool.get(), [&](size_t f, BufferedWriter &line) {
+    auto const &face = dcel.faces[f];
+    line << face.siteX << ' ' << face.siteY << ' ' << id(face.edge) << '\n';
+  });
+  out.formatLines(dcel.numHalfEdges(), pool.get(), [&](size_t i, BufferedWriter &line) {
+    auto const &e = dcel.halfEdges[i];
+    line << id(e.origin) << ' ' << id(e.twin) << ' ' << id(e.face) << ' ' << id(e.next) << ' ' << id(e.prev) << '\n';
+  });
+}
@@ -0,0 +1,215 @@
+#include "../include/lloyd.hpp"
+#include "../include/geometricFunctions.hpp"
+#include "../include/threadPool.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+/*
+ * The cell of an interior site is the polygon of the circumcenters of its triangles, in the order of its star. The
+ * cell of a hull site is open: it also has the rays of its two hull edges, which are cut far enough from the box
+ * for the clipping not to notice. Cells are convex, so they are clipped one side of the box at a time.
+ */
+
+namespace
+{
+  struct Box
+  {
+    double minX, maxX, minY, maxY;
+  };
+}
+
+/**
+ * Keep the part of the polygon where the coordinate is on the given side of bound (below it if below is set).
+ */
+static void clipPolygon(std::vector<PointDouble> &polygon, std::vector<PointDouble> &scratch, bool horizontal, double bound, bool below)
+{
+  auto coordinate = [&](PointDouble const &p) { return horizontal ? p.y : p.x; };
+  auto inside = [&](PointDouble const &p) { return below ? coordinate(p) <= bound : coordinate(p) >= bound; };
+
+  scratch.clear();
+  for (size_t i = 0; i < polygon.size(); i++)
+  {
+    auto const &a = polygon[i], &b = polygon[(i + 1) % polygon.size()];
+    if (inside(a))
+      scratch.push_back(a);
+    if (inside(a) != inside(b))
+    {
+      double t = (bound - coordinate(a)) / (coordinate(b) - coordinate(a));
+      scratch.push_back(PointDouble(a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t));
+    }
+  }
+  polygon.swap(scratch);
+}
+
+/**
+ * Polygon of the cell of the site, with the rays of a hull site cut at a distance that puts their ends and the
+ * segments between them out of the box. Circumcenters are indexed by face id.
+ */
+static void cellPolygon(PointInt const *site, std::vector<PointDouble> const &centers, Box const &box, std::vector<PointDouble> &polygon)
+{
+  polygon.clear();
+
+  // star in rotation order, starting after the spoke with the outer face on its right if the site is on the hull
+  HalfEdge<int> *first = site->outgoingEdge(), *hullRight = nullptr;
+  for (auto const &e : site->outgoingEdges())
+  {
+    if (e->face() == nullptr)
+      hullRight = e;
+  }
+  if (hullRight != nullptr)
+    first = hullRight->twin()->next();
+
+  HalfEdge<int> *hullLeft = nullptr;
+  auto e = first;
+  do
+  {
+    if (e->face() == nullptr)
+      break;
+    polygon.push_back(centers[e->face()->getId()]);
+    hullLeft = e;
+    e = e->twin()->next();
+  } while (e != first);
+  if (hullRight == nullptr || polygon.empty())
+    return;
+
+  // the rays are perpendicular to the hull edges, pointing out of the hull
+  PointDouble s(site->x, site->y);
+  double rx = hullRight->to()->y - site->y, ry = site->x - hullRight->to()->x;
+  double lx = site->y - hullLeft->to()->y, ly = hullLeft->to()->x - site->x;
+  double rLength = std::hypot(rx, ry), lLength = std::hypot(lx, ly);
+  rx /= rLength, ry /= rLength, lx /= lLength, ly /= lLength;
+  double bx = rx + lx, by = ry + ly, bLength = std::hypot(bx, by);
+  if (bLength < 1e-9)
+    bx = lx, by = ly, bLength = 1;
+  bx /= bLength, by /= bLength;
+
+  double extent = 0;
+  for (auto const &p : polygon)
+    extent = std::max(extent, std::hypot(p.x - s.x, p.y - s.y));
+  double far = 2 * (extent + (box.maxX - box.minX) + (box.maxY - box.minY));
+
+  PointDouble firstCenter = polygon.front(), lastCenter = polygon.back();
+  polygon.push_back(PointDouble(lastCenter.x + far * lx, lastCenter.y + far * ly));
+  polygon.push_back(PointDouble(s.x + far * bx, s.y + far * by));
+  polygon.push_back(PointDouble(firstCenter.x + far * rx, firstCenter.y + far * ry));
+}
+
+/**
+ * Centroid of the cell of the site clipped to the box, or the site itself if nothing is left of it.
+ */
+static PointDouble cellCentroid(PointInt const *site, std::vector<PointDouble> const &centers, Box const &box, std::vector<PointDouble> &polygon, std::vector<PointDouble> &scratch)
+{
+  PointDouble s(site->x, site->y);
+  if (site->outgoingEdge() == nullptr)
+    return s;
+  cellPolygon(site, centers, box, polygon);
+  clipPolygon(polygon, scratch, false, box.minX, false);
+  clipPolygon(polygon, scratch, false, box.maxX, true);
+  clipPolygon(polygon, scratch, true, box.minY, false);
+  clipPolygon(polygon, scratch, true, box.maxY, true);
+  if (polygon.size() < 3)
+    return s;
+
+  // relative to the site, to keep the products small
+  double area = 0, cx = 0, cy = 0;
+  for (size_t i = 0; i < polygon.size(); i++)
+  {
+    auto const &a = polygon[i], &b = polygon[(i + 1) % polygon.size()];
+    double ax = a.x - s.x, ay = a.y - s.y, bx = b.x - s.x, by = b.y - s.y;
+    double cross = ax * by - bx * ay;
+    area += cross;
+    cx += (ax + bx) * cross;
+    cy += (ay + by) * cross;
+  }
+  if (std::abs(area) < 1e-12)
+    return s;
+  return PointDouble(s.x + cx / (3 * area), s.y + cy / (3 * area));
+}
+
+RelaxationResult relaxSites(Delaunay &del, RelaxationOptions const &options)
+{
+  RelaxationResult result;
+  if (del.points.empty() || del.faces.empty())
+    return result;
+
+  Box box = {std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest(), std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest()};
+  for (auto const &p : del.points)
+  {
+    box.minX = std::min<double>(box.minX, p->x);
+    box.maxX = std::max<double>(box.maxX, p->x);
+    box.minY = std::min<double>(box.minY, p->y);
+    box.maxY = std::max<double>(box.maxY, p->y);
+  }
+  box.minX -= 5, box.maxX += 5, box.minY -= 5, box.maxY += 5;
+
+  ThreadPool pool(options.threads);
+  size_t const blockSize = 1 << 12;
+  auto parallelBlocks = [&](size_t n, std::function<void(size_t, size_t)> const &task) {
+    size_t blocks = (n + blockSize - 1) / blockSize;
+    if (blocks <= 1 || pool.size() == 1)
+      task(0, n);
+    else
+      pool.parallelFor(blocks, [&](size_t b) { task(b * blockSize, std::min(n, (b + 1) * blockSize)); });
+  };
+
+  std::vector<Face<int> *> triangles;
+  std::vector<PointDouble> centers, centroids;
+  std::vector<double> displacements;
+  while (result.iterations < options.maxIterations)
+  {
+    triangles.assign(del.faces.begin(), del.faces.end());
+    centers.resize(del.numFaceIds());
+    parallelBlocks(triangles.size(), [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++)
+      {
+        auto e = triangles[i]->edgeChain();
+        centers[triangles[i]->getId()] = geo::computeCircuncenter(PointDouble(e->from()->x, e->from()->y), PointDouble(e->to()->x, e->to()->y), PointDouble(e->next()->to()->x, e->next()->to()->y));
+      }
+    });
+
+    size_t n = del.points.size();
+    centroids.resize(n);
+    displacements.resize(n);
+    parallelBlocks(n, [&](size_t begin, size_t end) {
+      std::vector<PointDouble> polygon, scratch;
+      for (size_t i = begin; i < end; i++)
+      {
+        auto site = del.points[i];
+        centroids[i] = cellCentroid(site, centers, box, polygon, scratch);
+        displacements[i] = std::hypot(centroids[i].x - site->x, centroids[i].y - site->y);
+      }
+    });
+
+    result.maxDisplacement = *std::max_element(displacements.begin(), displacements.end());
+    if (result.maxDisplacement <= options.tolerance)
+    {
+      result.converged = true;
+      break;
+    }
+
+    result.iterations++;
+    std::vector<SiteMove> moves;
+    for (size_t i = 0; i < n; i++)
+    {
+      auto site = del.points[i];
+      int x = int(std::lround(centroids[i].x)), y = int(std::lround(centroids[i].y));
+      if (x != site->x || y != site->y)
+        moves.push_back({site, x, y});
+    }
+    del.moveSites(moves);
+
+    size_t moved = 0;
+    for (auto const &m : moves)
+    {
+      if (m.site->x == m.x && m.site->y == m.y)
+        moved++;
+    }
+    if (moved == 0)
+    {
+      result.converged = true;
+      break;
+    }
+  }
+  return result;
+}
@@ -2,16 +2,255 @@
 #include "../include/delaunay.hpp"
 #include "../include/ioFunctions.hpp"
 #include "../include/utils.hpp"
+#include "../include/streamingDelaunay.hpp"
+#include "../include/stats.hpp"
+#include "../include/lloyd.hpp"
+#include "../include/batch.hpp"
+#include "../include/server.hpp"
 #include <vector>
+#include <fstream>
+#include <cstring>
+#include <cstdlib>
+#include <iostream>
 
-int main()
+static void printDiagram(Voronoi const &vor, bool compact, bool binaryOutput, unsigned threads)
 {
+  STATS_START(output);
+  if (binaryOutput)
+    writeBinaryVoronoi(compactVoronoi(vor), std::cout);
+  else if (compact)
+    printVoronoi(compactVoronoi(vor), threads);
+  else
+    printVoronoi(vor, threads);
+  std::cout.flush();
+  STATS_STOP(output);
+}
+
+/**
+ * Write the report of --stats to the file, or to the standard error if it is "-".
+ */
+static void reportStats(char const *path)
+{
+  if (path == nullptr)
+    return;
+#ifdef VORONOI_STATS
+  if (strcmp(path, "-") == 0)
+  {
+    writeStats(std::cerr);
+    return;
+  }
+  std::ofstream out(path);
+  writeStats(out);
+  if (!out)
+  {
+    std::cerr << "Could not write " << path << "\n";
+    exit(-1);
+  }
+#endif
+}
+
+/**
+ * Print the diagram, then move the sites to each frame of the file in turn and print the repaired diagram.
+ */
+static void playFrames(char const *path, Delaunay &del, Voronoi &vor, bool compact, bool binaryOutput, unsigned threads)
+{
+  std::ifstream in(path);
+  if (!in)
+  {
+    std::cerr << "Could not open " << path << "\n";
+    exit(-1);
+  }
+
+  printDiagram(vor, compact, binaryOutput, threads);
+  std::vector<SiteMove> moves;
+  while (readFrame(in, del, moves))
+  {
+    vor.update(del, del.moveSites(moves));
+    printDiagram(vor, compact, binaryOutput, threads);
+  }
+}
+
+static void answerQueries(char const *path, Delaunay const &del, unsigned threads)
+{
+  std::vector<PointDouble> queries;
+  readQueries(path, queries);
+  printSiteIds(del.nearestSites(queries, threads), threads);
+}
+
+int main(int argc, char **argv)
+{
+  DelaunayOptions options;
+  bool compact = false;
+  bool fortune = false;
+  bool binaryOutput = false;
+  char const *binaryInput = nullptr;
+  char const *updates = nullptr;
+  char const *nearest = nullptr;
+  char const *frames = nullptr;
+  char const *statsPath = nullptr;
+  RelaxationOptions relaxation;
+  bool streaming = false;
+  bool batch = false;
+  char const *batchList = nullptr;
+  char const *servePath = nullptr;
+  char const *connectPath = nullptr;
+  char const *request = "voronoi";
+  ServerOptions server;
+  int tagGrid = 0;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--spatial-sort") == 0)
+      options.spatialSort = true;
+    else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+      options.seed = strtoul(argv[++i], nullptr, 10);
+    else if (strcmp(argv[i], "--compact") == 0)
+      compact = true;
+    else if (strcmp(argv[i], "--divide-and-conquer") == 0)
+      options.engine = DelaunayEngine::divideAndConquer;
+    else if (strcmp(argv[i], "--tiled") == 0)
+      options.engine = DelaunayEngine::tiled;
+    else if (strcmp(argv[i], "--tiles") == 0 && i + 1 < argc)
+      options.tiles = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+      options.threads = strtoul(argv[++i], nullptr, 10);
+    else if (strcmp(argv[i], "--fortune") == 0)
+      fortune = true;
+    else if (strcmp(argv[i], "--binary") == 0)
+      binaryOutput = true;
+    else if (strcmp(argv[i], "--print-binary") == 0 && i + 1 < argc)
+      binaryInput = argv[++i];
+    else if (strcmp(argv[i], "--updates") == 0 && i + 1 < argc)
+      updates = argv[++i];
+    else if (strcmp(argv[i], "--nearest") == 0 && i + 1 < argc)
+      nearest = argv[++i];
+    else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+      frames = argv[++i];
+    else if (strcmp(argv[i], "--batch") == 0)
+      batch = true;
+    else if (strcmp(argv[i], "--batch-list") == 0 && i + 1 < argc)
+      batchList = argv[++i];
+    else if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc)
+      servePath = argv[++i];
+    else if (strcmp(argv[i], "--max-request-bytes") == 0 && i + 1 < argc)
+      server.maxRequestBytes = strtoull(argv[++i], nullptr, 10);
+    else if (strcmp(argv[i], "--warmup-sites") == 0 && i + 1 < argc)
+      server.warmupSites = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--connect") == 0 && i + 1 < argc)
+      connectPath = argv[++i];
+    else if (strcmp(argv[i], "--request") == 0 && i + 1 < argc)
+      request = argv[++i];
+    else if (strcmp(argv[i], "--streaming") == 0)
+      streaming = true;
+    else if (strcmp(argv[i], "--tag-grid") == 0 && i + 1 < argc)
+      tagGrid = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--stats") == 0 && i + 1 < argc)
+      statsPath = argv[++i];
+    else if (strcmp(argv[i], "--relax") == 0 && i + 1 < argc)
+      relaxation.maxIterations = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--relax-tolerance") == 0 && i + 1 < argc)
+      relaxation.tolerance = strtod(argv[++i], nullptr);
+  }
+
+#ifndef VORONOI_STATS
+  if (statsPath != nullptr)
+  {
+    std::cerr << "--stats needs a build with the instrumentation compiled in (make STATS=1)\n";
+    exit(-1);
+  }
+#endif
+
+  // turn a site list into a tagged stream, and triangulate a tagged stream
+  if (tagGrid > 0)
+  {
+    tagSitesByGrid(tagGrid);
+    return 0;
+  }
+  if (streaming)
+  {
+    streamDelaunay();
+    return 0;
+  }
+
+  // answer site sets over a socket, or the standard streams if the path is "-", and send one request to a server
+  if (servePath != nullptr)
+  {
+    server.triangulation = options;
+    if (strcmp(servePath, "-") == 0)
+      serveStandardStreams(server);
+    else
+      serveSocket(servePath, server);
+    return 0;
+  }
+  if (connectPath != nullptr)
+    return requestServer(connectPath, request) ? 0 : -1;
+
+  // many site sets, each printed as a text diagram
+  if (batch || batchList != nullptr)
+  {
+    if (fortune || binaryOutput || updates != nullptr || nearest != nullptr || frames != nullptr || relaxation.maxIterations > 0 || statsPath != nullptr)
+    {
+      std::cerr << "--batch only prints diagrams, it can only be used with the triangulation options and --threads\n";
+      exit(-1);
+    }
+    int failed = batchList != nullptr ? runBatchFiles(batchList, options) : runBatch(options);
+    return failed > 0 ? -1 : 0;
+  }
+
+  // print a diagram written by --binary as text
+  if (binaryInput != nullptr)
+  {
+    printVoronoi(BinaryDcel(binaryInput), options.threads);
+    return 0;
+  }
+
+  std::vector<PointInt> siteStorage;
   pointIntVector sites;
-  readPoints(sites);
-  Delaunay delaunay(sites);
-  Voronoi vor(delaunay);
-  printVoronoi(vor);
+  STATS_START(parse);
+  readPoints(siteStorage, sites, options.threads);
+  STATS_STOP(parse);
+  if (fortune && (updates != nullptr || nearest != nullptr || relaxation.maxIterations > 0 || frames != nullptr))
+  {
+    std::cerr << (updates != nullptr ? "--updates" : nearest != nullptr ? "--nearest" : frames != nullptr ? "--frames" : "--relax") << " needs a triangulation, it can not be used with --fortune\n";
+    exit(-1);
+  }
+  if (frames != nullptr && nearest != nullptr)
+  {
+    std::cerr << "--frames prints a diagram per frame, it can not be used with --nearest\n";
+    exit(-1);
+  }
+  if (fortune)
+  {
+    Voronoi vor(sites);
+    printDiagram(vor, compact, binaryOutput, options.threads);
+    reportStats(statsPath);
+    return 0;
+  }
+
+  Delaunay delaunay(sites, options);
+  if (relaxation.maxIterations > 0)
+  {
+    relaxation.threads = options.threads;
+    relaxSites(delaunay, relaxation);
+  }
+  std::deque<PointInt> insertedSites;
+  if (nearest != nullptr && updates == nullptr)
+  {
+    // the diagram is not needed to answer the queries
+    answerQueries(nearest, delaunay, options.threads);
+    reportStats(statsPath);
+    return 0;
+  }
+
+  Voronoi vor(delaunay, options.threads);
+  if (updates != nullptr)
+    applyUpdates(updates, delaunay, vor, insertedSites);
+  if (nearest != nullptr)
+    answerQueries(nearest, delaunay, options.threads);
+  else if (frames != nullptr)
+    playFrames(frames, delaunay, vor, compact, binaryOutput, options.threads);
+  else
+    printDiagram(vor, compact, binaryOutput, options.threads);
+  reportStats(statsPath);
 
-  
   return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,155 @@
+#include "../include/delaunay.hpp"
+#include "../include/threadPool.hpp"
+#include <algorithm>
+#include <limits>
+
+/*
+ * In a Delaunay triangulation a site that is not the nearest to a query always has a neighbor closer to it, so
+ * greedy descent along the edges ends at the nearest site from anywhere. The walk only brings it close first:
+ * a visibility walk that steps across the edge the query is behind, which does not cycle in a Delaunay
+ * triangulation.
+ */
+
+static double squaredDistance(PointInt const *p, PointDouble const &q)
+{
+  double dx = p->x - q.x, dy = p->y - q.y;
+  return dx * dx + dy * dy;
+}
+
+/**
+ * Side of the line through the edge the query is on: positive on its left, which is outside of its face (faces
+ * are clockwise).
+ */
+static double side(HalfEdge<int> const *e, PointDouble const &q)
+{
+  double ax = e->from()->x, ay = e->from()->y;
+  return (double(e->to()->x) - ax) * (q.y - ay) - (double(e->to()->y) - ay) * (q.x - ax);
+}
+
+PointInt *Delaunay::nearestSite(PointDouble const &query, HalfEdge<int> *&edge) const
+{
+  // stop in the triangle that holds the query, or on the hull edge it is behind
+  bool moved = true;
+  while (moved)
+  {
+    moved = false;
+    for (int i = 0; i < 3 && !moved; i++, edge = edge->next())
+    {
+      if (side(edge, query) > 0)
+      {
+        if (edge->twin()->face() == nullptr)
+          break;
+        // the loop goes on from the edge after the one just crossed
+        edge = edge->twin();
+        moved = true;
+      }
+    }
+  }
+
+  // the nearest corner of the triangle is usually the answer
+  PointInt *nearest = nullptr;
+  double best = std::numeric_limits<double>::max();
+  auto corner = edge;
+  for (int i = 0; i < 3; i++, corner = corner->next())
+  {
+    double distance = squaredDistance(corner->from(), query);
+    if (distance < best)
+    {
+      best = distance;
+      nearest = corner->from();
+    }
+  }
+  bool improved = true;
+  while (improved)
+  {
+    improved = false;
+    for (auto const &e : nearest->outgoingEdges())
+    {
+      double distance = squaredDistance(e->to(), query);
+      if (distance < best)
+      {
+        best = distance;
+        nearest = e->to();
+        improved = true;
+      }
+    }
+  }
+  return nearest;
+}
+
+/**
+ * Answer a batch of queries:
+ *
+ * 1. Sort the queries along a Hilbert curve over their bounding box
+ * 2. Split the sorted queries in chunks, answered on a pool of threads; the triangulation is only read
+ * 3. Within a chunk, each walk starts from the triangle where the previous one ended
+ *
+ * Without triangles the sites are colinear, so they are sorted along their line and searched by projection.
+ */
+std::vector<int> Delaunay::nearestSites(std::vector<PointDouble> const &queries, unsigned threads) const
+{
+  std::vector<int> answers(queries.size(), 0);
+  if (queries.empty() || points.empty())
+    return answers;
+
+  if (faces.empty())
+  {
+    std::vector<PointInt *> line(points.begin(), points.end());
+    std::sort(line.begin(), line.end(), [](PointInt const *a, PointInt const *b) {
+      return a->x != b->x ? a->x < b->x : a->y < b->y;
+    });
+    double dx = line.back()->x - line.front()->x, dy = line.back()->y - line.front()->y;
+    auto position = [&](double x, double y) { return (x - line.front()->x) * dx + (y - line.front()->y) * dy; };
+
+    for (size_t i = 0; i < queries.size(); i++)
+    {
+      double t = position(queries[i].x, queries[i].y);
+      auto after = std::lower_bound(line.begin(), line.end(), t, [&](PointInt const *p, double value) {
+        return position(p->x, p->y) < value;
+      });
+      PointInt *nearest = after != line.end() ? *after : line.back();
+      if (after != line.begin() && squaredDistance(*(after - 1), queries[i]) <= squaredDistance(nearest, queries[i]))
+        nearest = *(after - 1);
+      answers[i] = nearest->getId();
+    }
+    return answers;
+  }
+
+  double minX = std::numeric_limits<double>::max(), maxX = std::numeric_limits<double>::lowest();
+  double minY = minX, maxY = maxX;
+  for (auto const &q : queries)
+  {
+    minX = std::min(minX, q.x);
+    maxX = std::max(maxX, q.x);
+    minY = std::min(minY, q.y);
+    maxY = std::max(maxY, q.y);
+  }
+  double scaleX = maxX > minX ? 65535.0 / (maxX - minX) : 0.0;
+  double scaleY = maxY > minY ? 65535.0 / (maxY - minY) : 0.0;
+
+  std::vector<std::pair<unsigned long long, size_t>> order(queries.size());
+  for (size_t i = 0; i < queries.size(); i++)
+    order[i] = {hilbertIndex(unsigned((queries[i].x - minX) * scaleX), unsigned((queries[i].y - minY) * scaleY)), i};
+  std::sort(order.begin(), order.end());
+
+
+  size_t const chunkSize = 1 << 12;
+  size_t chunks = (queries.size() + chunkSize - 1) / chunkSize;
+  auto answerChunk = [&](size_t c) {
+    auto edge = (*faces.begin())->edgeChain();
+    size_t end = std::min(queries.size(), (c + 1) * chunkSize);
+    for (size_t i = c * chunkSize; i < end; i++)
+      answers[order[i].second] = nearestSite(queries[order[i].second], edge)->getId();
+  };
+  if (chunks > 1 && threads != 1)
+  {
+    ThreadPool pool(threads);
+    pool.parallelFor(chunks, answerChunk);
+  }
+  else
+  {
+    for (size_t c = 0; c < chunks; c++)
+      answerChunk(c);
+  }
+  return answers;
+}
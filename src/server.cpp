@@ -0,0 +1,364 @@
+#include "../include/server.hpp"
+#include "../include/batch.hpp"
+#include "../include/inputBuffer.hpp"
+#include "../include/threadPool.hpp"
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <cerrno>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+namespace
+{
+  /**
+   * Two ends of a connection, with the reads buffered.
+   */
+  class Connection
+  {
+  public:
+    Connection(int in, int out) : in(in), out(out), begin(0), end(0) {}
+
+    /**
+     * Read a line without its newline, stopping after limit characters. Return false at the end of the input.
+     */
+    bool readLine(std::string &line, size_t limit)
+    {
+      line.clear();
+      while (line.size() < limit)
+      {
+        if (begin == end && !fill())
+          return !line.empty();
+        char c = buffer[begin++];
+        if (c == '\n')
+          return true;
+        line.push_back(c);
+      }
+      return true;
+    }
+
+    bool readBytes(std::vector<char> &bytes, size_t count)
+    {
+      bytes.resize(count);
+      for (size_t done = 0; done < count;)
+      {
+        if (begin == end && !fill())
+          return false;
+        size_t n = std::min(count - done, end - begin);
+        memcpy(bytes.data() + done, buffer + begin, n);
+        begin += n;
+        done += n;
+      }
+      return true;
+    }
+
+    bool write(char const *data, size_t count)
+    {
+      while (count > 0)
+      {
+        ssize_t n = ::write(out, data, count);
+        if (n < 0 && errno == EINTR)
+          continue;
+        if (n <= 0)
+          return false;
+        data += n;
+        count -= n;
+      }
+      return true;
+    }
+
+  private:
+    bool fill()
+    {
+      ssize_t n;
+      do
+        n = read(in, buffer, sizeof(buffer));
+      while (n < 0 && errno == EINTR);
+      begin = 0;
+      end = n > 0 ? size_t(n) : 0;
+      return n > 0;
+    }
+
+  private:
+    int in, out;
+    char buffer[1 << 16];
+    size_t begin, end;
+  };
+
+  /**
+   * Counts and latencies of the requests, shared by the workers.
+   */
+  class ServerMetrics
+  {
+  public:
+    void record(double ms, bool failed, bool rejected)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      latencies.push_back(float(ms));
+      this->failed += failed;
+      this->rejected += rejected;
+    }
+
+    std::string json()
+    {
+      std::vector<float> sorted;
+      unsigned long long failedCount, rejectedCount;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        sorted = latencies;
+        failedCount = failed;
+        rejectedCount = rejected;
+      }
+      std::sort(sorted.begin(), sorted.end());
+      auto percentile = [&](double p) { return sorted.empty() ? 0.0 : double(sorted[size_t(p * (sorted.size() - 1))]); };
+      double sum = 0;
+      for (auto const &ms : sorted)
+        sum += ms;
+
+      std::ostringstream out;
+      out << std::fixed;
+      out.precision(3);
+      out << "{\n  \"requests\": " << sorted.size() << ",\n  \"failed\": " << failedCount << ",\n  \"rejected\": " << rejectedCount << ",\n";
+      out << "  \"latencyMs\": {\"mean\": " << (sorted.empty() ? 0.0 : sum / sorted.size()) << ", \"p50\": " << percentile(0.5)
+          << ", \"p95\": " << percentile(0.95) << ", \"p99\": " << percentile(0.99) << ", \"max\": " << percentile(1) << "}\n";
+      out << "}\n";
+      return out.str();
+    }
+
+  private:
+    std::mutex mutex;
+    // every request answered, failed or not; rejected ones were over the size limit or malformed
+    std::vector<float> latencies;
+    unsigned long long failed = 0, rejected = 0;
+  };
+
+  struct ServerWorker
+  {
+    BatchWorker jobs;
+    std::vector<char> request;
+    BufferedWriter answer;
+  };
+}
+
+static bool reply(Connection &connection, bool ok, std::string const &body, double ms)
+{
+  std::string header = std::string(ok ? "ok " : "error ") + std::to_string(body.size()) + ' ' + std::to_string((long long)(ms * 1000)) + '\n';
+  return connection.write(header.data(), header.size()) && connection.write(body.data(), body.size());
+}
+
+/**
+ * Triangulate a jittered grid of sites, so the arenas and buffers of the worker are grown before the first request.
+ */
+static void warmUp(ServerWorker &worker, ServerOptions const &options)
+{
+  if (options.warmupSites <= 0)
+    return;
+  std::mt19937 rng(options.triangulation.seed);
+  std::uniform_int_distribution<int> jitter(0, 7);
+  int side = int(std::ceil(std::sqrt(double(options.warmupSites))));
+  std::string text = std::to_string(side * side) + '\n';
+  for (int i = 0; i < side; i++)
+  {
+    for (int j = 0; j < side; j++)
+      text += std::to_string(i * 16 + jitter(rng)) + ' ' + std::to_string(j * 16 + jitter(rng)) + '\n';
+  }
+  worker.answer.clear();
+  worker.jobs.run(text.data(), text.data() + text.size(), options.triangulation, false, worker.answer);
+  worker.answer.clear();
+}
+
+/**
+ * Answer the requests of a connection in order until it ends, a request is rejected, or a shutdown request, which
+ * calls shutdown.
+ */
+template <typename F>
+static void serveConnection(Connection &connection, ServerWorker &worker, ServerOptions const &options, ServerMetrics &metrics, F const &shutdown)
+{
+  std::string line;
+  while (connection.readLine(line, 64))
+  {
+    auto start = std::chrono::steady_clock::now();
+    auto elapsed = [&]() { return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(); };
+
+    auto space = line.find(' ');
+    std::string command = line.substr(0, space);
+    unsigned long long length = 0;
+    bool valid = space != std::string::npos;
+    if (valid)
+    {
+      auto result = std::from_chars(line.data() + space + 1, line.data() + line.size(), length);
+      valid = result.ec == std::errc() && result.ptr == line.data() + line.size();
+    }
+    if (!valid || (command != "voronoi" && command != "delaunay" && command != "stats" && command != "shutdown"))
+    {
+      metrics.record(elapsed(), true, true);
+      reply(connection, false, "malformed request header", elapsed());
+      return;
+    }
+    if (length > options.maxRequestBytes)
+    {
+      metrics.record(elapsed(), true, true);
+      reply(connection, false, "request of " + std::to_string(length) + " bytes is over the limit of " + std::to_string(options.maxRequestBytes), elapsed());
+      return;
+    }
+    if (!connection.readBytes(worker.request, length))
+      return;
+
+    if (command == "stats")
+    {
+      reply(connection, true, metrics.json(), elapsed());
+      continue;
+    }
+    if (command == "shutdown")
+    {
+      reply(connection, true, "", elapsed());
+      shutdown();
+      return;
+    }
+
+    worker.answer.clear();
+    auto error = worker.jobs.run(worker.request.data(), worker.request.data() + worker.request.size(), options.triangulation, command == "delaunay", worker.answer);
+    double ms = elapsed();
+    metrics.record(ms, !error.empty(), false);
+    if (!(error.empty() ? reply(connection, true, worker.answer.buffered(), ms) : reply(connection, false, error, ms)))
+      return;
+  }
+}
+
+/**
+ * Workers of the server; the instrumentation counters must only be updated by one thread.
+ */
+static unsigned serverThreads(ServerOptions const &options)
+{
+  unsigned threads = options.triangulation.threads;
+  STATS_ONLY(threads = 1);
+  return threads;
+}
+
+void serveSocket(char const *path, ServerOptions const &options)
+{
+  sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(address.sun_path))
+  {
+    std::cerr << "Socket path too long: " << path << "\n";
+    exit(-1);
+  }
+  strcpy(address.sun_path, path);
+
+  // a client that goes away is noticed by the failed write, instead of killing the server
+  signal(SIGPIPE, SIG_IGN);
+  int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  unlink(path);
+  if (listener < 0 || bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || listen(listener, 128) != 0)
+  {
+    std::cerr << "Could not listen on " << path << ": " << strerror(errno) << "\n";
+    exit(-1);
+  }
+
+  ThreadPool pool(serverThreads(options));
+  std::vector<ServerWorker> workers(pool.size());
+  pool.parallelFor(workers.size(), [&](size_t w) { warmUp(workers[w], options); });
+
+  ServerMetrics metrics;
+  std::atomic<bool> stopping(false);
+  // shutting the listener down wakes every worker blocked in accept
+  auto shutdown = [&]() {
+    stopping = true;
+    ::shutdown(listener, SHUT_RDWR);
+  };
+  pool.parallelFor(workers.size(), [&](size_t w) {
+    while (!stopping)
+    {
+      int client = accept(listener, nullptr, nullptr);
+      if (client < 0)
+      {
+        if (errno == EINTR || errno == ECONNABORTED)
+          continue;
+        break;
+      }
+      Connection connection(client, client);
+      serveConnection(connection, workers[w], options, metrics, shutdown);
+      close(client);
+    }
+  });
+
+  close(listener);
+  unlink(path);
+  std::cerr << metrics.json();
+}
+
+void serveStandardStreams(ServerOptions const &options)
+{
+  signal(SIGPIPE, SIG_IGN);
+  ServerWorker worker;
+  warmUp(worker, options);
+
+  ServerMetrics metrics;
+  Connection connection(STDIN_FILENO, STDOUT_FILENO);
+  serveConnection(connection, worker, options, metrics, []() {});
+  std::cerr << metrics.json();
+}
+
+bool requestServer(char const *path, char const *command)
+{
+  sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+  int server = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (server < 0 || connect(server, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0)
+  {
+    std::cerr << "Could not connect to " << path << ": " << strerror(errno) << "\n";
+    exit(-1);
+  }
+
+  Connection connection(server, server);
+  bool hasBody = strcmp(command, "stats") != 0 && strcmp(command, "shutdown") != 0;
+  std::string header = std::string(command) + ' ';
+  if (hasBody)
+  {
+    InputBuffer input;
+    header += std::to_string(input.end() - input.begin()) + '\n';
+    connection.write(header.data(), header.size());
+    connection.write(input.begin(), input.end() - input.begin());
+  }
+  else
+  {
+    header += "0\n";
+    connection.write(header.data(), header.size());
+  }
+
+  std::string line;
+  std::vector<char> body;
+  unsigned long long length = 0;
+  auto space = line.npos;
+  if (connection.readLine(line, 64) && (space = line.find(' ')) != line.npos)
+    std::from_chars(line.data() + space + 1, line.data() + line.size(), length);
+  if (space == line.npos || !connection.readBytes(body, length))
+  {
+    std::cerr << "No answer from " << path << "\n";
+    exit(-1);
+  }
+  close(server);
+
+  if (line.compare(0, space, "ok") != 0)
+  {
+    std::cerr << "Server error: " << std::string(body.begin(), body.end()) << "\n";
+    return false;
+  }
+  std::cout.write(body.data(), body.size());
+  return true;
+}
@@ -0,0 +1,32 @@
+#include "../include/stats.hpp"
+
+#ifdef VORONOI_STATS
+
+Stats stats;
+
+void writeStats(std::ostream &out)
+{
+  static char const *const phaseNames[] = {"parse", "triangulate", "removeBoundingTriangle", "circumcenters", "edgeBuild", "output"};
+
+  auto flags = out.flags();
+  out << std::fixed;
+  out.precision(3);
+
+  out << "{\n  \"phasesMs\": {";
+  for (int i = 0; i < int(Phase::count); i++)
+    out << (i > 0 ? ", " : "") << "\"" << phaseNames[i] << "\": " << stats.phaseMs[i];
+  out << "},\n";
+
+  double meanScanned = stats.findTriangleCalls > 0 ? double(stats.facesScanned) / stats.findTriangleCalls : 0.0;
+  out << "  \"findTriangle\": {\"calls\": " << stats.findTriangleCalls << ", \"facesScanned\": " << stats.facesScanned
+      << ", \"meanFacesScanned\": " << meanScanned << ", \"maxFacesScanned\": " << stats.maxFacesScanned << "},\n";
+  out << "  \"legalizeEdge\": {\"flips\": " << stats.flips << ", \"maxDepth\": " << stats.maxLegalizeDepth << "},\n";
+  out << "  \"boundingVertexRemovals\": " << stats.boundingVertexRemovals << ",\n";
+  out << "  \"mergedCircumcenters\": " << stats.mergedCircuncenters << ",\n";
+  out << "  \"findBoundingSegment\": {\"calls\": " << stats.boundingSegmentSearches << ", \"steps\": " << stats.boundingSegmentSteps << "}\n";
+  out << "}\n";
+
+  out.flags(flags);
+}
+
+#endif
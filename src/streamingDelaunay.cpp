@@ -0,0 +1,602 @@
+#include "../include/streamingDelaunay.hpp"
+#include "../include/predicates.hpp"
+#include "../include/inputBuffer.hpp"
+#include <iostream>
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <unistd.h>
+
+int StreamGrid::column(double x) const
+{
+  double width = (double(maxX) - minX + 1) / cols;
+  double c = std::floor((x - minX) / width);
+  return c < 0 ? 0 : c >= cols ? cols - 1 : int(c);
+}
+
+int StreamGrid::row(double y) const
+{
+  double height = (double(maxY) - minY + 1) / rows;
+  double r = std::floor((y - minY) / height);
+  return r < 0 ? 0 : r >= rows ? rows - 1 : int(r);
+}
+
+StreamingDelaunay::StreamingDelaunay(StreamGrid const &grid, BufferedWriter &out)
+    : grid(grid), out(out), liveTriangles(0), peak(0), finalized(grid.numCells(), false), waiting(grid.numCells()),
+      hook(grid.numCells(), -1), started(false), siteCount(0), insertion(0), lastTriangle(-1)
+{
+  // vertex 0 is the vertex at infinity of the ghost triangles
+  vertices.push_back({0, 0, 0, 0, true});
+}
+
+int StreamingDelaunay::newVertex(int x, int y, int id)
+{
+  Vertex v = {x, y, id, 0, false};
+  if (!freeVertices.empty())
+  {
+    int index = freeVertices.back();
+    freeVertices.pop_back();
+    vertices[index] = v;
+    return index;
+  }
+  vertices.push_back(v);
+  return int(vertices.size()) - 1;
+}
+
+int StreamingDelaunay::newTriangle(int a, int b, int c)
+{
+  int t;
+  if (!freeTriangles.empty())
+  {
+    t = freeTriangles.back();
+    freeTriangles.pop_back();
+  }
+  else
+  {
+    t = int(triangles.size());
+    triangles.push_back(Triangle());
+    triangles[t].generation = 0;
+    triangles[t].mark = 0;
+  }
+
+  auto &tri = triangles[t];
+  tri.vertex[0] = a;
+  tri.vertex[1] = b;
+  tri.vertex[2] = c;
+  tri.neighbor[0] = tri.neighbor[1] = tri.neighbor[2] = -1;
+  tri.live = true;
+  for (int v : tri.vertex)
+    vertices[v].triangles++;
+
+  liveTriangles++;
+  peak = std::max(peak, liveTriangles);
+  lastTriangle = t;
+  return t;
+}
+
+void StreamingDelaunay::releaseTriangle(int t)
+{
+  auto &tri = triangles[t];
+  tri.live = false;
+  tri.generation++;
+  for (int v : tri.vertex)
+    vertices[v].triangles--;
+  liveTriangles--;
+  freeTriangles.push_back(t);
+}
+
+bool StreamingDelaunay::isGhost(int t) const
+{
+  auto const &v = triangles[t].vertex;
+  return v[0] == ghost || v[1] == ghost || v[2] == ghost;
+}
+
+/**
+ * A solid triangle is in conflict with p if p is strictly inside its circumcircle. A ghost triangle (a, b, ghost)
+ * stands for the half-plane at the left of a -> b, outside the hull, and is in conflict with the points strictly
+ * inside it or strictly between a and b.
+ */
+bool StreamingDelaunay::inConflict(int t, Vertex const &p) const
+{
+  auto const &v = triangles[t].vertex;
+  PointInt q(p.x, p.y);
+  for (int i = 0; i < 3; i++)
+  {
+    if (v[i] == ghost)
+    {
+      auto const &a = vertices[v[(i + 1) % 3]], &b = vertices[v[(i + 2) % 3]];
+      PointInt pa(a.x, a.y), pb(b.x, b.y);
+      int side = geo::orient2d(pa, pb, q);
+      if (side != 0)
+        return side > 0;
+      long long dot = (long long)(q.x - pa.x) * (pb.x - pa.x) + (long long)(q.y - pa.y) * (pb.y - pa.y);
+      long long length = (long long)(pb.x - pa.x) * (pb.x - pa.x) + (long long)(pb.y - pa.y) * (pb.y - pa.y);
+      return dot > 0 && dot < length;
+    }
+  }
+
+  auto const &a = vertices[v[0]], &b = vertices[v[1]], &c = vertices[v[2]];
+  return geo::incircle(PointInt(a.x, a.y), PointInt(b.x, b.y), PointInt(c.x, c.y), q) > 0;
+}
+
+/**
+ * Walk from start towards p, crossing the edges that separate the current triangle from p. Return a triangle in
+ * conflict with p, or -1 if p repeats a site or the walk runs into a triangle that was already written.
+ */
+int StreamingDelaunay::locate(Vertex const &p, int start)
+{
+  int t = start;
+  PointInt q(p.x, p.y);
+  unsigned turn = insertion;
+  size_t steps = 0;
+
+  while (steps++ <= liveTriangles)
+  {
+    if (isGhost(t))
+    {
+      if (inConflict(t, p))
+        return t;
+      // step inside the hull, across the solid edge of the ghost triangle
+      auto const &v = triangles[t].vertex;
+      int next = triangles[t].neighbor[v[0] == ghost ? 0 : v[1] == ghost ? 1 : 2];
+      if (next < 0)
+        return -1;
+      t = next;
+      continue;
+    }
+
+    auto const &tri = triangles[t];
+    int next = -1;
+    for (int k = 0; k < 3 && next < 0; k++)
+    {
+      int i = (k + turn) % 3;
+      auto const &a = vertices[tri.vertex[(i + 1) % 3]], &b = vertices[tri.vertex[(i + 2) % 3]];
+      if (geo::orient2d(PointInt(a.x, a.y), PointInt(b.x, b.y), q) < 0)
+      {
+        next = tri.neighbor[i];
+        if (next < 0)
+          return -1;
+      }
+    }
+    if (next < 0)
+      return inConflict(t, p) ? t : -1;
+    t = next;
+    turn++;
+  }
+  return -1;
+}
+
+void StreamingDelaunay::insert(int x, int y)
+{
+  siteCount++;
+  if (!grid.contains(x, y))
+  {
+    std::cerr << "Invalid stream: site " << siteCount << " is outside the grid\n";
+    exit(-1);
+  }
+  if (finalized[grid.cellOf(x, y)])
+  {
+    std::cerr << "Invalid stream: site " << siteCount << " is in a finalized cell\n";
+    exit(-1);
+  }
+
+  if (!started)
+  {
+    pending.push_back({x, y, siteCount, 0, false});
+    start();
+    return;
+  }
+  insertVertex(newVertex(x, y, siteCount));
+}
+
+/**
+ * Build the first triangle and its three ghost triangles once three sites are not colinear, then insert the
+ * sites that came before.
+ */
+void StreamingDelaunay::start()
+{
+  auto const &a = pending.front();
+  size_t second = 0, third = 0;
+  for (size_t i = 1; i < pending.size() && second == 0; i++)
+  {
+    if (pending[i].x != a.x || pending[i].y != a.y)
+      second = i;
+  }
+  if (second == 0)
+    return;
+  auto const &b = pending[second];
+  for (size_t i = second + 1; i < pending.size() && third == 0; i++)
+  {
+    if (geo::orient2d(PointInt(a.x, a.y), PointInt(b.x, b.y), PointInt(pending[i].x, pending[i].y)) != 0)
+      third = i;
+  }
+  if (third == 0)
+    return;
+
+  int va = newVertex(a.x, a.y, a.id), vb = newVertex(b.x, b.y, b.id);
+  int vc = newVertex(pending[third].x, pending[third].y, pending[third].id);
+  if (geo::orient2d(PointInt(a.x, a.y), PointInt(b.x, b.y), PointInt(pending[third].x, pending[third].y)) < 0)
+    std::swap(vb, vc);
+
+  int solid = newTriangle(va, vb, vc);
+  int ghosts[3] = {newTriangle(vc, vb, ghost), newTriangle(va, vc, ghost), newTriangle(vb, va, ghost)};
+  for (int i = 0; i < 3; i++)
+  {
+    // ghosts[i] is across the edge of the solid triangle opposite its vertex i
+    triangles[solid].neighbor[i] = ghosts[i];
+    triangles[ghosts[i]].neighbor[2] = solid;
+    // and shares its edges through infinity with the other two
+    triangles[ghosts[i]].neighbor[0] = ghosts[(i + 2) % 3];
+    triangles[ghosts[i]].neighbor[1] = ghosts[(i + 1) % 3];
+  }
+  started = true;
+
+  std::vector<Vertex> rest;
+  rest.swap(pending);
+  schedule(solid);
+  for (size_t i = 1; i < rest.size(); i++)
+  {
+    if (i != second && i != third)
+      insertVertex(newVertex(rest[i].x, rest[i].y, rest[i].id));
+  }
+}
+
+void StreamingDelaunay::insertVertex(int v)
+{
+  auto const p = vertices[v];
+  int cell = grid.cellOf(p.x, p.y);
+  insertion++;
+
+  int startTriangle = hook[cell] >= 0 && triangles[hook[cell]].live ? hook[cell] : lastTriangle;
+  int first = startTriangle >= 0 && triangles[startTriangle].live ? locate(p, startTriangle) : -1;
+  if (first < 0)
+  {
+    // the walk was blocked by written triangles (or p is a repeated site): look at every triangle
+    for (size_t t = 0; t < triangles.size() && first < 0; t++)
+    {
+      if (triangles[t].live && inConflict(int(t), p))
+        first = int(t);
+    }
+    if (first < 0)
+    {
+      freeVertices.push_back(v);
+      return;
+    }
+  }
+
+  // the cavity is the set of triangles in conflict with p, and its boundary the edges to the others
+  cavity.clear();
+  boundary.clear();
+  stack.assign(1, first);
+  triangles[first].mark = insertion;
+  while (!stack.empty())
+  {
+    int t = stack.back();
+    stack.pop_back();
+    cavity.push_back(t);
+    for (int i = 0; i < 3; i++)
+    {
+      int n = triangles[t].neighbor[i];
+      if (n >= 0 && triangles[n].mark == insertion)
+        continue;
+      if (n >= 0 && inConflict(n, p))
+      {
+        triangles[n].mark = insertion;
+        stack.push_back(n);
+      }
+      else
+        boundary.push_back({t, i});
+    }
+  }
+
+  // fan the boundary edges to p
+  created.clear();
+  createdByFirst.clear();
+  for (auto const &edge : boundary)
+  {
+    auto const &old = triangles[edge.first];
+    int a = old.vertex[(edge.second + 1) % 3], b = old.vertex[(edge.second + 2) % 3];
+    int outer = old.neighbor[edge.second];
+    int t = newTriangle(v, a, b);
+    triangles[t].neighbor[0] = outer;
+    if (outer >= 0)
+    {
+      auto &o = triangles[outer];
+      for (int j = 0; j < 3; j++)
+      {
+        if (o.vertex[j] != a && o.vertex[j] != b)
+          o.neighbor[j] = t;
+      }
+    }
+    created.push_back(t);
+    createdByFirst[a] = t;
+  }
+  for (int t : created)
+  {
+    int next = createdByFirst[triangles[t].vertex[2]];
+    triangles[t].neighbor[1] = next;
+    triangles[next].neighbor[2] = t;
+  }
+
+  for (int t : cavity)
+    releaseTriangle(t);
+  hook[cell] = created.front();
+  for (int t : created)
+  {
+    if (triangles[t].live && !isGhost(t))
+      schedule(t);
+  }
+}
+
+void StreamingDelaunay::schedule(int t)
+{
+  auto const &v = triangles[t].vertex;
+  auto const &a = vertices[v[0]], &b = vertices[v[1]], &c = vertices[v[2]];
+
+  // circumcircle, slightly enlarged so rounding can not make it miss a cell
+  double ax = a.x, ay = a.y, bx = b.x, by = b.y, cx = c.x, cy = c.y;
+  double d = 2 * (ax * (by - cy) + bx * (cy - ay) + cx * (ay - by));
+  double ux = ((ax * ax + ay * ay) * (by - cy) + (bx * bx + by * by) * (cy - ay) + (cx * cx + cy * cy) * (ay - by)) / d;
+  double uy = ((ax * ax + ay * ay) * (cx - bx) + (bx * bx + by * by) * (ax - cx) + (cx * cx + cy * cy) * (bx - ax)) / d;
+  double r = std::sqrt((ux - ax) * (ux - ax) + (uy - ay) * (uy - ay));
+  r += 1e-9 * (r + std::fabs(ux) + std::fabs(uy)) + 1e-9;
+
+  // no site can come from outside the grid
+  if (!std::isfinite(r) || (ux + r >= grid.minX && ux - r <= grid.maxX && uy + r >= grid.minY && uy - r <= grid.maxY))
+  {
+    int firstColumn = grid.column(ux - r), lastColumn = grid.column(ux + r);
+    int firstRow = grid.row(uy - r), lastRow = grid.row(uy + r);
+    if (!std::isfinite(r))
+      firstColumn = firstRow = 0, lastColumn = grid.cols - 1, lastRow = grid.rows - 1;
+
+    for (int row = firstRow; row <= lastRow; row++)
+    {
+      for (int column = firstColumn; column <= lastColumn; column++)
+      {
+        int cell = row * grid.cols + column;
+        if (!finalized[cell])
+        {
+          waiting[cell].push_back({t, triangles[t].generation});
+          return;
+        }
+      }
+    }
+  }
+  write(t);
+}
+
+void StreamingDelaunay::write(int t)
+{
+  auto &tri = triangles[t];
+  for (int v : tri.vertex)
+  {
+    auto &vertex = vertices[v];
+    if (!vertex.written)
+    {
+      out << "v " << vertex.id << ' ' << vertex.x << ' ' << vertex.y << '\n';
+      vertex.written = true;
+    }
+  }
+  out << "t " << vertices[tri.vertex[0]].id << ' ' << vertices[tri.vertex[2]].id << ' ' << vertices[tri.vertex[1]].id << '\n';
+
+  for (int i = 0; i < 3; i++)
+  {
+    int n = tri.neighbor[i];
+    if (n < 0)
+      continue;
+    for (int j = 0; j < 3; j++)
+    {
+      if (triangles[n].neighbor[j] == t)
+        triangles[n].neighbor[j] = -1;
+    }
+  }
+  releaseTriangle(t);
+  for (int v : tri.vertex)
+  {
+    if (vertices[v].triangles == 0)
+      freeVertices.push_back(v);
+  }
+}
+
+void StreamingDelaunay::finalizeCell(int cell)
+{
+  if (cell < 0 || cell >= grid.numCells())
+  {
+    std::cerr << "Invalid stream: there is no cell " << cell << "\n";
+    exit(-1);
+  }
+  if (finalized[cell])
+    return;
+  finalized[cell] = true;
+  hook[cell] = -1;
+
+  std::vector<std::pair<int, unsigned>> list;
+  list.swap(waiting[cell]);
+  for (auto const &entry : list)
+  {
+    if (triangles[entry.first].live && triangles[entry.first].generation == entry.second)
+      schedule(entry.first);
+  }
+}
+
+void StreamingDelaunay::finish()
+{
+  for (size_t t = 0; t < triangles.size(); t++)
+  {
+    if (triangles[t].live && !isGhost(int(t)))
+      write(int(t));
+  }
+}
+
+/**
+ * Tokens of the standard input, read in blocks so the stream never has to fit in memory.
+ */
+class TokenReader
+{
+public:
+  TokenReader() : buffer(1 << 20), position(0), size(0), eof(false) {}
+
+  /**
+   * Next token, or an empty one at the end of the input.
+   */
+  std::pair<char const *, size_t> next()
+  {
+    while (true)
+    {
+      while (position < size && isBlank(buffer[position]))
+        position++;
+      size_t end = position;
+      while (end < size && !isBlank(buffer[end]))
+        end++;
+      if (end < size || (eof && end > position))
+      {
+        std::pair<char const *, size_t> token(&buffer[position], end - position);
+        position = end;
+        return token;
+      }
+      if (eof)
+        return {nullptr, 0};
+      refill();
+    }
+  }
+
+  int nextInteger()
+  {
+    auto token = next();
+    int value;
+    auto result = std::from_chars(token.first, token.first + token.second, value);
+    if (token.second == 0 || result.ec != std::errc() || result.ptr != token.first + token.second)
+    {
+      std::cerr << "Invalid stream: expected an integer\n";
+      exit(-1);
+    }
+    return value;
+  }
+
+private:
+  void refill()
+  {
+    size_t rest = size - position;
+    memmove(buffer.data(), buffer.data() + position, rest);
+    if (rest == buffer.size())
+      buffer.resize(2 * buffer.size());
+    ssize_t count = read(STDIN_FILENO, buffer.data() + rest, buffer.size() - rest);
+    eof = count <= 0;
+    position = 0;
+    size = rest + (count > 0 ? count : 0);
+  }
+
+private:
+  std::vector<char> buffer;
+  size_t position, size;
+  bool eof;
+};
+
+void streamDelaunay()
+{
+  TokenReader input;
+  auto token = input.next();
+  if (token.second != 1 || token.first[0] != 'g')
+  {
+    std::cerr << "Invalid stream: it must start with the grid\n";
+    exit(-1);
+  }
+  StreamGrid grid;
+  grid.cols = input.nextInteger();
+  grid.rows = input.nextInteger();
+  grid.minX = input.nextInteger();
+  grid.minY = input.nextInteger();
+  grid.maxX = input.nextInteger();
+  grid.maxY = input.nextInteger();
+  if (grid.cols <= 0 || grid.rows <= 0 || (long long)grid.cols * grid.rows > (1 << 26) || grid.minX > grid.maxX || grid.minY > grid.maxY)
+  {
+    std::cerr << "Invalid stream: bad grid\n";
+    exit(-1);
+  }
+
+  BufferedWriter out(&std::cout);
+  StreamingDelaunay triangulation(grid, out);
+  while ((token = input.next()).second != 0)
+  {
+    if (token.second == 1 && token.first[0] == 'v')
+    {
+      int x = input.nextInteger();
+      int y = input.nextInteger();
+      triangulation.insert(x, y);
+    }
+    else if (token.second == 1 && token.first[0] == 'f')
+      triangulation.finalizeCell(input.nextInteger());
+    else
+    {
+      std::cerr << "Invalid stream: unknown tag " << std::string(token.first, token.second) << "\n";
+      exit(-1);
+    }
+  }
+  triangulation.finish();
+}
+
+/**
+ * Scanner over a site list in the usual input format.
+ */
+struct SiteScanner
+{
+  char const *position, *end;
+
+  bool nextInteger(long long &value)
+  {
+    while (position < end && isBlank(*position))
+      position++;
+    auto result = std::from_chars(position, end, value);
+    if (result.ec != std::errc())
+      return false;
+    position = result.ptr;
+    return true;
+  }
+};
+
+void tagSitesByGrid(int resolution)
+{
+  InputBuffer input;
+  SiteScanner scanner = {input.begin(), input.end()};
+  long long n, x, y;
+  if (!scanner.nextInteger(n) || n < 0)
+  {
+    std::cerr << "Invalid input: the first value must be the number of sites\n";
+    exit(-1);
+  }
+  char const *sites = scanner.position;
+
+  StreamGrid grid = {resolution, resolution, std::numeric_limits<int>::max(), std::numeric_limits<int>::max(),
+                     std::numeric_limits<int>::min(), std::numeric_limits<int>::min()};
+  for (long long i = 0; i < n; i++)
+  {
+    if (!scanner.nextInteger(x) || !scanner.nextInteger(y))
+    {
+      std::cerr << "Invalid input: expected " << n << " sites, found " << i << "\n";
+      exit(-1);
+    }
+    grid.minX = std::min<long long>(grid.minX, x);
+    grid.maxX = std::max<long long>(grid.maxX, x);
+    grid.minY = std::min<long long>(grid.minY, y);
+    grid.maxY = std::max<long long>(grid.maxY, y);
+  }
+  if (n == 0)
+    grid.minX = grid.minY = grid.maxX = grid.maxY = 0;
+
+  BufferedWriter out(&std::cout);
+  out << "g " << grid.cols << ' ' << grid.rows << ' ' << grid.minX << ' ' << grid.minY << ' ' << grid.maxX << ' ' << grid.maxY << '\n';
+  for (int row = 0; row < grid.rows; row++)
+  {
+    scanner.position = sites;
+    for (long long i = 0; i < n; i++)
+    {
+      scanner.nextInteger(x);
+      scanner.nextInteger(y);
+      if (grid.row(y) == row)
+        out << "v " << x << ' ' << y << '\n';
+    }
+    for (int column = 0; column < grid.cols; column++)
+      out << "f " << row * grid.cols + column << '\n';
+  }
+}
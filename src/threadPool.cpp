@@ -0,0 +1,77 @@
+#include "../include/threadPool.hpp"
+
+ThreadPool::ThreadPool(unsigned threads) : job(nullptr), jobSize(0), nextTask(0), busy(0), generation(0), stopping(false)
+{
+  if (threads == 0)
+    threads = std::thread::hardware_concurrency();
+  for (unsigned i = 1; i < threads; i++)
+    workers.emplace_back(&ThreadPool::work, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (auto &w : workers)
+    w.join();
+}
+
+void ThreadPool::parallelFor(size_t count, std::function<void(size_t)> const &task)
+{
+  if (count == 0)
+    return;
+  if (workers.empty() || count == 1)
+  {
+    for (size_t i = 0; i < count; i++)
+      task(i);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    job = &task;
+    jobSize = count;
+    nextTask = 0;
+    busy = workers.size();
+    generation++;
+  }
+  wake.notify_all();
+
+  runTasks();
+
+  // the job must outlive every worker that picked it up
+  std::unique_lock<std::mutex> lock(mutex);
+  finished.wait(lock, [this] { return busy == 0; });
+  job = nullptr;
+}
+
+void ThreadPool::work()
+{
+  unsigned long seen = 0;
+  while (true)
+  {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      wake.wait(lock, [&] { return stopping || generation != seen; });
+      if (stopping)
+        return;
+      seen = generation;
+    }
+
+    runTasks();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (--busy == 0)
+      finished.notify_one();
+  }
+}
+
+void ThreadPool::runTasks()
+{
+  size_t i;
+  while ((i = nextTask.fetch_add(1)) < jobSize)
+    (*job)(i);
+}
@@ -9,4 +9,30 @@ bool compareDoubleEqual(double a, double b)
 bool compareDoublePointEqual(PointDouble const &a, PointDouble const &b)
 {
   return compareDoubleEqual(a.x, b.x) && compareDoubleEqual(a.y, b.y);
+}
+
+unsigned long long hilbertIndex(unsigned x, unsigned y)
+{
+  unsigned long long d = 0;
+  unsigned rx, ry, tmp;
+  for (unsigned s = 1u << 15; s > 0; s /= 2)
+  {
+    rx = (x & s) > 0;
+    ry = (y & s) > 0;
+    d += (unsigned long long)s * s * ((3 * rx) ^ ry);
+
+    // rotate quadrant
+    if (ry == 0)
+    {
+      if (rx == 1)
+      {
+        x = 0xFFFF - x;
+        y = 0xFFFF - y;
+      }
+      tmp = x;
+      x = y;
+      y = tmp;
+    }
+  }
+  return d;
 }
\ No newline at end of file
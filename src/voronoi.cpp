@@ -1,10 +1,22 @@
 #include "../include/voronoi.hpp"
 #include "../include/utils.hpp"
 #include "../include/geometricFunctions.hpp"
+#include "../include/circuncenterBatch.hpp"
+#include "../include/threadPool.hpp"
+#include "../include/stats.hpp"
 #include <limits>
+#include <iterator>
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <unordered_set>
 
-Voronoi::Voronoi(Delaunay const &del)
+Voronoi::Voronoi(Delaunay const &del, unsigned threads) : threads(threads)
+{
+  build(del);
+}
+
+void Voronoi::build(Delaunay const &del)
 {
   int maxX = std::numeric_limits<int>::min();
   int minX = std::numeric_limits<int>::max();
@@ -31,14 +43,63 @@ Voronoi::Voronoi(Delaunay const &del)
   buildDiagram(del);
 }
 
+void Voronoi::reset(Delaunay const &del, unsigned threads)
+{
+  this->threads = threads;
+  clear();
+  build(del);
+}
+
+void Voronoi::clear()
+{
+  arena.reset();
+  sites.clear();
+  diagramVertices.clear();
+  diagramFaces.clear();
+  siteFaceReference.clear();
+  cornerExternalBoundingEdge.clear();
+  for (auto &side : boundaryIndex)
+    side.clear();
+  triangleCircuncenters.clear();
+  edgeReference.clear();
+  faceReference.clear();
+}
+
+Voronoi::Voronoi(pointIntVector const &input)
+{
+  int maxX = std::numeric_limits<int>::min();
+  int minX = std::numeric_limits<int>::max();
+  int maxY = std::numeric_limits<int>::min();
+  int minY = std::numeric_limits<int>::max();
+
+  for (auto const &p : input)
+  {
+    maxX = p->x > maxX ? p->x : maxX;
+    minX = p->x < minX ? p->x : minX;
+
+    maxY = p->y > maxY ? p->y : maxY;
+    minY = p->y < minY ? p->y : minY;
+    sites.push_back(p);
+  }
+  if (sites.empty())
+    return;
+
+  boundaryMaxX = maxX + 5;
+  boundaryMinX = minX - 5;
+  boundaryMaxY = maxY + 5;
+  boundaryMinY = minY - 5;
+
+  Fortune fortune(sites, boundaryMinX, boundaryMaxX, boundaryMinY, boundaryMaxY);
+  assembleDiagram(fortune.graph);
+}
+
 /**
  * Build Voronoi diagram
  * 
  * It follows this algorithm:
  * 
- * 1. For each triangle T in the Delaunay triangulation do:
- *    1.1 Compute circuncenter and store it in a map indexed by the face.
- *        If it is close enough to a neighbor's circuncenter, store neighbor's instead
+ * 1. Compute the circuncenters of all triangles in a batch and store them in a table indexed by the face id.
+ *    If one is close enough to a neighbor's circuncenter, store neighbor's instead
  * 2. For each site S in the Delaunay triangulation  from top to bottom do:
  *    2.1 For each edge E incient do S do:
  *        2.1.1 Create an edge Ev for the diagram according to local conditions (neighboring faces and edges)
@@ -46,48 +107,13 @@ Voronoi::Voronoi(Delaunay const &del)
  */
 void Voronoi::buildDiagram(Delaunay const &del)
 {
-  std::vector<HalfEdge<int> *> triangleEdges;
-  // Compute circuncenter and store it in a map indexed by the face.
-  if (!del.faces.empty())
-  {
-    for (auto const &f : del.faces)
-    {
-      triangleEdges.clear();
-      triangleEdges.push_back(f->edgeChain());
-      triangleEdges.push_back(f->edgeChain()->next());
-      triangleEdges.push_back(f->edgeChain()->prev());
-
-      auto circuncenter = geo::computeCircuncenter(PointDouble(*triangleEdges[0]->from()), PointDouble(*triangleEdges[1]->from()), PointDouble(*triangleEdges[2]->from()));
-
-      PointDouble *circuncenterPtr = nullptr;
-
-      // check for the existence of a equivalent circuncenter in the neighborhood
-      for (auto const &e : triangleEdges)
-      {
-        if (e->twin()->face() != nullptr)
-        {
-          auto neighborTrianle = e->twin()->face();
-          // check if neighbor's circuncenter hs been already computated
-          if (triangleCircuncenters.count(neighborTrianle) > 0)
-          {
-            // check if circuncenters are close enough to be the same
-            if (compareDoubleEqual(geo::computeDistance(circuncenter, *triangleCircuncenters[neighborTrianle]), 0.0))
-              circuncenterPtr = triangleCircuncenters[neighborTrianle];
-          }
-        }
-      }
-
-      if (circuncenterPtr == nullptr)
-      {
-        circuncenterPtr = new PointDouble(circuncenter.x, circuncenter.y);
-        diagramVertices.push_back(circuncenterPtr);
-      }
-
-      // insert circuncenter in the data structures
-      triangleCircuncenters[f] = circuncenterPtr;
-    }
-  }
+  triangleCircuncenters.assign(del.numFaceIds(), nullptr);
+  edgeReference.assign(del.numHalfEdges(), nullptr);
+  STATS_START(circuncenters);
+  computeCircuncenters(del);
+  STATS_STOP(circuncenters);
 
+  STATS_START(edgeBuild);
   HalfEdge<double> *newEdge;
   // create edges
   do
@@ -95,9 +121,9 @@ void Voronoi::buildDiagram(Delaunay const &del)
     auto p = sitesQueue.top();
     sitesQueue.pop();
 
-    for (auto const &e : p->incidentEdges)
+    for (auto const &e : p->outgoingEdges())
     {
-      if (edgeReference.count(e) <= 0)
+      if (edgeReference[e->getId()] == nullptr)
       {
         if (e->face() == nullptr && e->twin()->face() == nullptr)
         {
@@ -126,25 +152,291 @@ void Voronoi::buildDiagram(Delaunay const &del)
     }
   } while (!sitesQueue.empty());
 
+  // Rays that cross the box can make the splits above leave the cycles of two sites on one face, so a site
+  // whose face is already taken gets a face of its own
   for (auto &p : sites)
   {
-    for (auto &e : p->incidentEdges)
+    if (p->outgoingEdge() == nullptr)
+      continue;
+    auto ref = edgeReference[p->outgoingEdge()->getId()];
+    auto face = ref->face();
+    auto owner = siteFaceReference[face->getId()];
+    if (owner != nullptr && owner != p)
+    {
+      face->setChain(edgeReference[owner->outgoingEdge()->getId()]);
+      face = arena.faces.create();
+      geo::setFace(ref, face);
+      addFace(face);
+    }
+    siteFaceReference[face->getId()] = p;
+    faceReference[siteIndex(p)] = face;
+  }
+
+  // Coincident circuncenters share a vertex, so the edge between their triangles is a zero-length loop.
+  // Contract those edges, so the star of every vertex is a single rotation cycle.
+  std::vector<HalfEdge<double> *> loops;
+  for (auto const &e : edgeReference)
+  {
+    if (e != nullptr && e->from() == e->to() && e < e->twin())
+      loops.push_back(e);
+  }
+  for (auto const &e : loops)
+    contractEdge(e);
+  STATS_STOP(edgeBuild);
+}
+
+void Voronoi::assembleDiagram(VoronoiGraph const &graph)
+{
+  for (auto const &v : graph.vertices)
+    addVertex(arena.points.create(v.x, v.y));
+
+  // half-edges 2i and 2i + 1 come from graph edge i, with the site on their right
+  std::vector<HalfEdge<double> *> halfEdges;
+  std::vector<int> rightSite;
+  std::vector<std::vector<int>> stars(graph.vertices.size());
+  halfEdges.reserve(2 * graph.edges.size());
+  rightSite.reserve(2 * graph.edges.size());
+
+  for (auto const &e : graph.edges)
+  {
+    auto from = diagramVertices[e.from], to = diagramVertices[e.to];
+    auto edge = arena.edges.create(from, to);
+    auto twin = arena.edges.create(to, from);
+    edge->setTwin(twin);
+    twin->setTwin(edge);
+
+    int site = -1, otherSite = -1;
+    if (e.site1 >= 0)
+    {
+      double side = (to->x - from->x) * (sites[e.site1]->y - from->y) - (to->y - from->y) * (sites[e.site1]->x - from->x);
+      site = side < 0 ? e.site1 : e.site2;
+      otherSite = side < 0 ? e.site2 : e.site1;
+    }
+
+    stars[e.from].push_back(int(halfEdges.size()));
+    halfEdges.push_back(edge);
+    rightSite.push_back(site);
+    stars[e.to].push_back(int(halfEdges.size()));
+    halfEdges.push_back(twin);
+    rightSite.push_back(otherSite);
+  }
+
+  // counterclockwise order around each vertex, so next(e) is the edge after twin(e) around its origin
+  std::vector<int> starPosition(halfEdges.size());
+  for (size_t v = 0; v < stars.size(); v++)
+  {
+    auto &star = stars[v];
+    auto origin = diagramVertices[v];
+    std::vector<std::pair<double, int>> angles;
+    for (auto const &h : star)
+      angles.push_back({atan2(halfEdges[h]->to()->y - origin->y, halfEdges[h]->to()->x - origin->x), h});
+    std::sort(angles.begin(), angles.end());
+    for (size_t i = 0; i < star.size(); i++)
+    {
+      star[i] = angles[i].second;
+      starPosition[star[i]] = int(i);
+    }
+    if (!star.empty())
+      origin->setOutgoingEdge(halfEdges[star[0]]);
+  }
+
+  std::vector<int> nextEdge(halfEdges.size());
+  for (size_t h = 0; h < halfEdges.size(); h++)
+  {
+    auto const &edge = graph.edges[h / 2];
+    auto const &star = stars[h % 2 == 0 ? edge.to : edge.from];
+    nextEdge[h] = star[(starPosition[h ^ 1] + 1) % star.size()];
+    halfEdges[h]->setNext(halfEdges[nextEdge[h]]);
+    halfEdges[nextEdge[h]]->setPrev(halfEdges[h]);
+  }
+
+  // the chain around the box is the only counterclockwise one
+  std::vector<bool> visited(halfEdges.size(), false);
+  for (size_t h = 0; h < halfEdges.size(); h++)
+  {
+    if (visited[h])
+      continue;
+
+    double area = 0;
+    int site = -1;
+    int current = int(h);
+    do
+    {
+      visited[current] = true;
+      auto e = halfEdges[current];
+      area += e->from()->x * e->to()->y - e->to()->x * e->from()->y;
+      if (site < 0)
+        site = rightSite[current];
+      current = nextEdge[current];
+    } while (current != int(h));
+
+    if (area > 0)
+      continue;
+
+    auto face = arena.faces.create();
+    geo::setFace(halfEdges[h], face);
+    addFace(face);
+    if (site >= 0)
+      siteFaceReference[face->getId()] = sites[site];
+  }
+}
+
+void Voronoi::computeCircuncenters(Delaunay const &del)
+{
+  // ids recycled by updates may leave holes
+  size_t n = del.numFaceIds();
+  std::vector<Face<int> *> triangles(n, nullptr);
+  for (auto const &f : del.faces)
+    triangles[f->getId()] = f;
+
+  // neighbors[3 * i + j] is the triangle across the j-th edge of triangle i, or -1 on the hull
+  std::vector<int> neighbors(3 * n);
+  CircuncenterBatch batch;
+  batch.resize(n);
+
+  auto gather = [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++)
+    {
+      if (triangles[i] == nullptr)
+      {
+        batch.x1[i] = batch.y1[i] = batch.x2[i] = batch.y2[i] = batch.x3[i] = batch.y3[i] = 0;
+        neighbors[3 * i] = neighbors[3 * i + 1] = neighbors[3 * i + 2] = -1;
+        continue;
+      }
+      HalfEdge<int> *edges[3] = {triangles[i]->edgeChain(), triangles[i]->edgeChain()->next(), triangles[i]->edgeChain()->prev()};
+      batch.x1[i] = edges[0]->from()->x;
+      batch.y1[i] = edges[0]->from()->y;
+      batch.x2[i] = edges[1]->from()->x;
+      batch.y2[i] = edges[1]->from()->y;
+      batch.x3[i] = edges[2]->from()->x;
+      batch.y3[i] = edges[2]->from()->y;
+      for (int j = 0; j < 3; j++)
+      {
+        auto neighbor = edges[j]->twin()->face();
+        neighbors[3 * i + j] = neighbor != nullptr ? neighbor->getId() : -1;
+      }
+    }
+    batch.compute(begin, end);
+  };
+
+  // small diagrams are not worth starting threads
+  size_t const blockSize = 1 << 14;
+  if (n <= blockSize || threads == 1)
+    gather(0, n);
+  else
+  {
+    ThreadPool pool(threads);
+    pool.parallelFor((n + blockSize - 1) / blockSize, [&](size_t block) {
+      gather(block * blockSize, std::min(n, (block + 1) * blockSize));
+    });
+  }
+
+  // Merge pass, in id order: a circuncenter close enough to the vertex already given to a neighbor triangle
+  // shares that vertex.
+  for (size_t i = 0; i < n; i++)
+  {
+    if (triangles[i] == nullptr)
+      continue;
+    PointDouble circuncenter(batch.centerX[i], batch.centerY[i]);
+    PointDouble *circuncenterPtr = nullptr;
+
+    for (int j = 0; j < 3; j++)
+    {
+      int neighbor = neighbors[3 * i + j];
+      if (neighbor >= 0 && size_t(neighbor) < i)
+      {
+        if (compareDoubleEqual(geo::computeDistance(circuncenter, *triangleCircuncenters[neighbor]), 0.0))
+          circuncenterPtr = triangleCircuncenters[neighbor];
+      }
+    }
+
+    if (circuncenterPtr == nullptr)
     {
-      auto ref = edgeReference[e];
-      auto f = ref->face();
-      siteFaceReference[f] = p;
+      circuncenterPtr = arena.points.create(circuncenter.x, circuncenter.y);
+      addVertex(circuncenterPtr);
     }
+    else
+      STATS_ADD(mergedCircuncenters, 1);
+    triangleCircuncenters[i] = circuncenterPtr;
   }
 }
 
+void Voronoi::addFace(Face<double> *face)
+{
+  face->setId(int(diagramFaces.size()));
+  diagramFaces.push_back(face);
+  siteFaceReference.push_back(nullptr);
+}
+
+void Voronoi::addVertex(PointDouble *vertex)
+{
+  diagramVertices.push_back(vertex);
+  vertex->setId(int(diagramVertices.size()));
+}
+
+void Voronoi::removeFace(Face<double> *face)
+{
+  size_t index = size_t(face->getId());
+  diagramFaces[index] = diagramFaces.back();
+  siteFaceReference[index] = siteFaceReference.back();
+  diagramFaces[index]->setId(int(index));
+  diagramFaces.pop_back();
+  siteFaceReference.pop_back();
+  arena.faces.destroy(face);
+}
+
+void Voronoi::removeVertex(PointDouble *vertex)
+{
+  size_t index = size_t(vertex->getId() - 1);
+  diagramVertices[index] = diagramVertices.back();
+  diagramVertices[index]->setId(int(index + 1));
+  diagramVertices.pop_back();
+  arena.points.destroy(vertex);
+}
+
+void Voronoi::contractEdge(HalfEdge<double> *edge)
+{
+  auto twin = edge->twin();
+  auto vertex = edge->from();
+
+  edge->prev()->setNext(edge->next());
+  edge->next()->setPrev(edge->prev());
+  twin->prev()->setNext(twin->next());
+  twin->next()->setPrev(twin->prev());
+
+  if (edge->face() != nullptr && edge->face()->edgeChain() == edge)
+    edge->face()->setChain(edge->next());
+  if (twin->face() != nullptr && twin->face()->edgeChain() == twin)
+    twin->face()->setChain(twin->next());
+  if (vertex->outgoingEdge() == edge || vertex->outgoingEdge() == twin)
+    vertex->setOutgoingEdge(edge->next());
+
+  arena.edges.destroy(edge);
+  arena.edges.destroy(twin);
+}
+
+/*
+ * Sides of the box are named by the corner they start at and are walked clockwise: the top and left sides in
+ * ascending order of their coordinate, the bottom and right ones in descending order.
+ */
+static constexpr bool horizontalSide(corners corner)
+{
+  return corner == corners::top_left || corner == corners::bottom_right;
+}
+
+static constexpr bool ascendingSide(corners corner)
+{
+  return corner == corners::top_left || corner == corners::bottom_left;
+}
+
 void Voronoi::prepareVoronoi()
 {
-  diagramVertices.push_back(new PointDouble(boundaryMaxX, boundaryMaxY));
-  diagramVertices.push_back(new PointDouble(boundaryMaxX, boundaryMinY));
-  diagramVertices.push_back(new PointDouble(boundaryMinX, boundaryMinY));
-  diagramVertices.push_back(new PointDouble(boundaryMinX, boundaryMaxY));
+  addVertex(arena.points.create(boundaryMaxX, boundaryMaxY));
+  addVertex(arena.points.create(boundaryMaxX, boundaryMinY));
+  addVertex(arena.points.create(boundaryMinX, boundaryMinY));
+  addVertex(arena.points.create(boundaryMinX, boundaryMaxY));
 
-  auto face = new Face<double>();
+  auto face = arena.faces.create();
 
   HalfEdge<double> *tmpEdge;
   HalfEdge<double> *prevEdge = nullptr;
@@ -152,7 +444,7 @@ void Voronoi::prepareVoronoi()
 
   for (size_t i = 1; i <= diagramVertices.size(); i++)
   {
-    tmpEdge = geo::createEdgeP2P<double>(diagramVertices[i - 1], diagramVertices[i % diagramVertices.size()], nullptr, face);
+    tmpEdge = geo::createEdgeP2P<double>(arena, diagramVertices[i - 1], diagramVertices[i % diagramVertices.size()], nullptr, face);
     cornerExternalBoundingEdge.push_back(tmpEdge->twin());
 
     if (firstEdge == nullptr)
@@ -178,396 +470,261 @@ void Voronoi::prepareVoronoi()
   firstEdge->twin()->setNext(tmpEdge->twin());
 
   geo::setFace(firstEdge, face);
-  diagramFaces.push_back(face);
+  addFace(face);
 
-  for (auto &s : sites)
-  {
-    faceReference[s] = face;
-  }
+  // the edges were created from the top right corner
+  indexBoundary(firstEdge);
+  faceReference.assign(sites.size(), face);
 }
 
-HalfEdge<double> *Voronoi::findBoundingSegment(PointDouble const &p, corners corner, geo::axis axis, geo::order order)
+void Voronoi::indexBoundary(HalfEdge<double> *firstEdge)
 {
-  double limitValue, fromCoord, toCoord;
-  double relevantPointCoord = axis == geo::axis::horizontal ? p.x : p.y;
-  auto tmpEdge = cornerExternalBoundingEdge[int(corner)];
-
-  if (axis == geo::axis::horizontal)
+  // Each side is indexed from the corner it starts at, walking clockwise, and ends at the first point of the
+  // next side
+  corners const sideStart[4] = {corners::top_right, corners::bottom_right, corners::bottom_left, corners::top_left};
+  auto edge = firstEdge;
+  for (int i = 0; i < 4; i++)
   {
-    if (order == geo::order::ascending)
-      limitValue = boundaryMaxX;
-    else
-      limitValue = boundaryMinX;
+    bool horizontal = horizontalSide(sideStart[i]);
+    bool ascending = ascendingSide(sideStart[i]);
+    auto &side = boundaryIndex[int(sideStart[i])];
+
+    double start = horizontal ? edge->from()->x : edge->from()->y;
+    double end = horizontal ? edge->to()->x : edge->to()->y;
+    side[ascending ? start : -start] = edge;
+    side[ascending ? end : -end] = edge->next();
+    edge = edge->next();
   }
-  else
+}
+
+void Voronoi::resizeBoundary(double minX, double maxX, double minY, double maxY)
+{
+  // the keys of the top right side are negated, so its first one is the top right corner
+  auto firstEdge = boundaryIndex[int(corners::top_right)].begin()->second;
+  PointDouble const cornerPoints[4] = {PointDouble(maxX, maxY), PointDouble(maxX, minY), PointDouble(minX, minY), PointDouble(minX, maxY)};
+  auto edge = firstEdge;
+  for (int i = 0; i < 4; i++)
   {
-    if (order == geo::order::ascending)
-      limitValue = boundaryMaxY;
-    else
-      limitValue = boundaryMinY;
+    edge->from()->x = cornerPoints[i].x;
+    edge->from()->y = cornerPoints[i].y;
+    edge = edge->next();
   }
-  do
-  {
-    fromCoord = axis == geo::axis::horizontal ? tmpEdge->from()->x : tmpEdge->from()->y;
-    toCoord = axis == geo::axis::horizontal ? tmpEdge->prev()->from()->x : tmpEdge->prev()->from()->y;
-
-    if (compareDoubleEqual(fromCoord, relevantPointCoord))
-    {
-      return tmpEdge->prev()->twin();
-    }
-    if (order == geo::order::ascending ? relevantPointCoord < toCoord : relevantPointCoord > toCoord)
-    {
-      return tmpEdge->prev()->twin();
-    }
-    tmpEdge = tmpEdge->prev();
-
-  } while (order == geo::order::ascending ? fromCoord < limitValue : fromCoord > limitValue);
 
-  return nullptr;
+  boundaryMinX = minX;
+  boundaryMaxX = maxX;
+  boundaryMinY = minY;
+  boundaryMaxY = maxY;
+  for (auto &side : boundaryIndex)
+    side.clear();
+  indexBoundary(firstEdge);
 }
 
-struct _segmentRecord
+template <corners corner>
+HalfEdge<double> *Voronoi::findBoundingSegment(double coord)
 {
-  double t;
-  HalfEdge<double> *edge;
-};
+  auto const &side = boundaryIndex[int(corner)];
+  auto key = ascendingSide(corner) ? coord : -coord;
+
+  // The chain of the side is walked from its first point and the walk stops at the first segment that begins at
+  // the point or ends after it. That is the segment that contains the point, unless the points just before it
+  // are equal to it.
+  STATS_ADD(boundingSegmentSearches, 1);
+  auto segment = side.upper_bound(key);
+  if (segment != side.begin())
+    segment--;
+
+  auto from = [](std::map<double, HalfEdge<double> *>::const_iterator it) {
+    return horizontalSide(corner) ? it->second->from()->x : it->second->from()->y;
+  };
+  if (std::next(segment) == side.end() && !compareDoubleEqual(from(segment), coord))
+    return nullptr;
+
+  while (segment != side.begin() && compareDoubleEqual(from(std::prev(segment)), coord))
+  {
+    STATS_ADD(boundingSegmentSteps, 1);
+    segment--;
+  }
+  return segment->second;
+}
 
-HalfEdge<double> *Voronoi::createInfiniteEdge(HalfEdge<int> *edge)
+template <corners corner>
+void Voronoi::insertBoundaryPoint(PointDouble *p, HalfEdge<double> *segment)
 {
-  auto normal = geo::computeUnitaryNormal(*edge);
-  auto point = PointDouble(double(edge->from()->x + edge->to()->x) / 2.0, double(edge->from()->y + edge->to()->y) / 2.0);
-
-  std::vector<_segmentRecord> pointsOnBoundary;
-
-  HalfEdge<double> *tmpEdge;
-  PointDouble *tmpPoint;
+  geo::insertPointInEdge(arena, p, segment);
+  double coord = horizontalSide(corner) ? p->x : p->y;
+  boundaryIndex[int(corner)][ascendingSide(corner) ? coord : -coord] = segment->next();
+}
 
-  double t;
+template <corners corner, bool ray>
+bool Voronoi::clipToSide(PointDouble const &point, PointDouble const &normal, BoundaryHit &hit)
+{
+  constexpr bool horizontal = horizontalSide(corner);
 
-  if (!compareDoubleEqual(normal.y, 0.0))
+  // line of the side, and the range it spans with the corner it starts at
+  double sideLine, low, high, first;
+  switch (corner)
   {
-    // check against top boundary
-    t = (boundaryMaxY - point.y) / normal.y;
-    auto xVal = (point.x + normal.x * t);
+  case corners::top_left:
+    sideLine = boundaryMaxY, low = boundaryMinX, high = boundaryMaxX, first = boundaryMinX;
+    break;
+  case corners::bottom_right:
+    sideLine = boundaryMinY, low = boundaryMinX, high = boundaryMaxX, first = boundaryMaxX;
+    break;
+  case corners::bottom_left:
+    sideLine = boundaryMinX, low = boundaryMinY, high = boundaryMaxY, first = boundaryMinY;
+    break;
+  default:
+    sideLine = boundaryMaxX, low = boundaryMinY, high = boundaryMaxY, first = boundaryMaxY;
+    break;
+  }
 
-    // x_min <= x < x_max
-    if (compareDoubleEqual(xVal, boundaryMinX) || (xVal > boundaryMinX && xVal < boundaryMaxX))
-    {
-      tmpPoint = new PointDouble(xVal, boundaryMaxY);
-      tmpEdge = findBoundingSegment(*tmpPoint, corners::top_left, geo::axis::horizontal, geo::order::ascending);
-      if (tmpEdge == nullptr)
-      {
-        std::cerr << "Calculations failed\n";
-        exit(-1);
-      }
-      else
-      {
-        if (compareDoublePointEqual(*tmpEdge->from(), *tmpPoint))
-        {
-          delete tmpPoint;
-          pointsOnBoundary.push_back({t, tmpEdge});
-        }
-        else
-        {
-          diagramVertices.push_back(tmpPoint);
-          geo::insertPointInEdge(tmpPoint, tmpEdge);
-          pointsOnBoundary.push_back({t, tmpEdge->next()});
-        }
-      }
-    }
+  double across = horizontal ? normal.y : normal.x;
+  if (compareDoubleEqual(across, 0.0))
+    return false;
 
-    // check against bottom boundary
-    t = (boundaryMinY - point.y) / normal.y;
-    xVal = (point.x + normal.x * t);
+  double t = (sideLine - (horizontal ? point.y : point.x)) / across;
+  double along = horizontal ? point.x + normal.x * t : point.y + normal.y * t;
 
-    // x_min < x <= x_max
-    if (compareDoubleEqual(xVal, boundaryMaxX) || (xVal > boundaryMinX && xVal < boundaryMaxX))
-    {
-      tmpPoint = new PointDouble(xVal, boundaryMinY);
-      tmpEdge = findBoundingSegment(*tmpPoint, corners::bottom_right, geo::axis::horizontal, geo::order::descending);
-      if (tmpEdge == nullptr)
-      {
-        std::cerr << "Calculations failed\n";
-        exit(-1);
-      }
-      else
-      {
-        if (compareDoublePointEqual(*tmpEdge->from(), *tmpPoint))
-        {
-          delete tmpPoint;
-          pointsOnBoundary.push_back({t, tmpEdge});
-        }
-        else
-        {
-          diagramVertices.push_back(tmpPoint);
-          geo::insertPointInEdge(tmpPoint, tmpEdge);
-          pointsOnBoundary.push_back({t, tmpEdge->next()});
-        }
-      }
-    }
+  // Each side owns the corner it starts at: first <= along < last, in walking order
+  if (ray && t <= 0)
+    return false;
+  if (!compareDoubleEqual(along, first) && !(along > low && along < high))
+    return false;
+
+  PointDouble candidate = horizontal ? PointDouble(along, sideLine) : PointDouble(sideLine, along);
+  auto segment = findBoundingSegment<corner>(along);
+  if (segment == nullptr)
+  {
+    std::cerr << "Calculations failed\n";
+    exit(-1);
   }
 
-  if (!compareDoubleEqual(normal.y, 0.0))
+  hit.t = t;
+  if (compareDoublePointEqual(*segment->from(), candidate))
+    hit.edge = segment;
+  else
   {
-    // check against left boundary
-    t = (boundaryMinX - point.x) / normal.x;
-    auto yVal = (point.y + normal.y * t);
+    auto newPoint = arena.points.create(candidate.x, candidate.y);
+    addVertex(newPoint);
+    insertBoundaryPoint<corner>(newPoint, segment);
+    hit.edge = segment->next();
+  }
+  return true;
+}
 
-    // y_min <= y < y_max
-    if (compareDoubleEqual(yVal, boundaryMinY) || (yVal > boundaryMinY && yVal < boundaryMaxY))
+template <bool ray>
+int Voronoi::clipToBoundary(PointDouble const &point, PointDouble const &normal, BoundaryHit hits[2])
+{
+  BoundaryHit hit;
+  int count = 0;
+  auto record = [&]() {
+    if (count == 2)
     {
-      tmpPoint = new PointDouble(boundaryMinX, yVal);
-      tmpEdge = findBoundingSegment(*tmpPoint, corners::bottom_left, geo::axis::vertical, geo::order::ascending);
-      if (tmpEdge == nullptr)
-      {
-        std::cerr << "Calculations failed\n";
-        exit(-1);
-      }
-      else
-      {
-        if (compareDoublePointEqual(*tmpEdge->from(), *tmpPoint))
-        {
-          delete tmpPoint;
-          pointsOnBoundary.push_back({t, tmpEdge});
-        }
-        else
-        {
-          diagramVertices.push_back(tmpPoint);
-          geo::insertPointInEdge(tmpPoint, tmpEdge);
-          pointsOnBoundary.push_back({t, tmpEdge->next()});
-        }
-      }
+      std::cerr << "Calculations failed\n";
+      exit(-1);
     }
+    hits[count++] = hit;
+  };
+
+  if (clipToSide<corners::top_left, ray>(point, normal, hit))
+    record();
+  if (clipToSide<corners::bottom_right, ray>(point, normal, hit))
+    record();
+  if (clipToSide<corners::bottom_left, ray>(point, normal, hit))
+    record();
+  if (clipToSide<corners::top_right, ray>(point, normal, hit))
+    record();
+  return count;
+}
 
-    // check against right boundary
-    t = (boundaryMaxX - point.x) / normal.x;
-    yVal = (point.y + normal.y * t);
-
-    // y_min < y <= y_max
-    if (compareDoubleEqual(yVal, boundaryMaxY) || (yVal >= boundaryMinY && yVal <= boundaryMaxY))
-    {
-      tmpPoint = new PointDouble(boundaryMaxX, yVal);
-      tmpEdge = findBoundingSegment(*tmpPoint, corners::top_right, geo::axis::vertical, geo::order::descending);
-      if (tmpEdge == nullptr)
-      {
-        std::cerr << "Calculations failed\n";
-        exit(-1);
-      }
-      else
-      {
-        if (compareDoublePointEqual(*tmpEdge->from(), *tmpPoint))
-        {
-          delete tmpPoint;
-          pointsOnBoundary.push_back({t, tmpEdge});
-        }
-        else
-        {
-          diagramVertices.push_back(tmpPoint);
-          geo::insertPointInEdge(tmpPoint, tmpEdge);
-          pointsOnBoundary.push_back({t, tmpEdge->next()});
-        }
-      }
-    }
-  }
+HalfEdge<double> *Voronoi::createInfiniteEdge(HalfEdge<int> *edge)
+{
+  auto normal = geo::computeUnitaryNormal(*edge);
+  auto point = PointDouble(double(edge->from()->x + edge->to()->x) / 2.0, double(edge->from()->y + edge->to()->y) / 2.0);
 
-  if (pointsOnBoundary.size() != 2)
+  BoundaryHit pointsOnBoundary[2];
+  if (clipToBoundary<false>(point, normal, pointsOnBoundary) != 2)
   {
     std::cerr << "Calculations failed\n";
     exit(-1);
   }
 
   HalfEdge<double> *newEdge;
-  auto newFace = geo::insertDiagonal(pointsOnBoundary[0].edge, pointsOnBoundary[1].edge, &newEdge, true);
-  diagramFaces.push_back(newFace);
+  auto newFace = geo::insertDiagonal(arena, pointsOnBoundary[0].edge, pointsOnBoundary[1].edge, &newEdge, true);
+  addFace(newFace);
 
   if (pointsOnBoundary[0].t > pointsOnBoundary[1].t)
   {
-    edgeReference[edge] = newEdge;
-    edgeReference[edge->twin()] = newEdge->twin();
+    edgeReference[edge->getId()] = newEdge;
+    edgeReference[edge->twin()->getId()] = newEdge->twin();
 
-    faceReference[edge->from()] = newEdge->face();
-    faceReference[edge->to()] = newEdge->twin()->face();
+    faceReference[siteIndex(edge->from())] = newEdge->face();
+    faceReference[siteIndex(edge->to())] = newEdge->twin()->face();
     return newEdge;
   }
   else
   {
-    edgeReference[edge] = newEdge->twin();
-    edgeReference[edge->twin()] = newEdge;
+    edgeReference[edge->getId()] = newEdge->twin();
+    edgeReference[edge->twin()->getId()] = newEdge;
 
-    faceReference[edge->from()] = newEdge->twin()->face();
-    faceReference[edge->to()] = newEdge->face();
+    faceReference[siteIndex(edge->from())] = newEdge->twin()->face();
+    faceReference[siteIndex(edge->to())] = newEdge->face();
     return newEdge->twin();
   }
 }
 
-HalfEdge<double> *Voronoi::createSemiInfiniteEdge(HalfEdge<int> *edge, bool reverse)
+HalfEdge<double> *Voronoi::clipHullRay(HalfEdge<int> *edge)
 {
   auto normal = geo::computeUnitaryNormal(*edge);
   auto point = PointDouble(double(edge->from()->x + edge->to()->x) / 2.0, double(edge->from()->y + edge->to()->y) / 2.0);
 
-  HalfEdge<double> *pointOnBoundary;
-  HalfEdge<double> *tmpEdge, *neighboorEdge;
-  PointDouble *tmpPoint;
-
-  double t;
-
-  if (!compareDoubleEqual(normal.y, 0.0))
+  // a ray that grazes a corner may hit both sides, the last one is taken
+  BoundaryHit hits[2];
+  int count = clipToBoundary<true>(point, normal, hits);
+  if (count == 0)
   {
-    // check against top boundary
-    t = (boundaryMaxY - point.y) / normal.y;
-    auto xVal = (point.x + normal.x * t);
-
-    // x_min <= x < x_max
-    if (t > 0 && (compareDoubleEqual(xVal, boundaryMinX) || (xVal > boundaryMinX && xVal < boundaryMaxX)))
-    {
-      tmpPoint = new PointDouble(xVal, boundaryMaxY);
-      tmpEdge = findBoundingSegment(*tmpPoint, corners::top_left, geo::axis::horizontal, geo::order::ascending);
-      if (tmpEdge == nullptr)
-      {
-        std::cerr << "Calculations failed\n";
-        exit(-1);
-      }
-      else
-      {
-        if (compareDoublePointEqual(*tmpEdge->from(), *tmpPoint))
-        {
-          delete tmpPoint;
-          pointOnBoundary = tmpEdge;
-        }
-        else
-        {
-          diagramVertices.push_back(tmpPoint);
-          geo::insertPointInEdge(tmpPoint, tmpEdge);
-          pointOnBoundary = tmpEdge->next();
-        }
-      }
-    }
-
-    // check against bottom boundary
-    t = (boundaryMinY - point.y) / normal.y;
-    xVal = (point.x + normal.x * t);
-
-    // x_min < x <= x_max
-    if (t > 0 && (compareDoubleEqual(xVal, boundaryMaxX) || (xVal > boundaryMinX && xVal < boundaryMaxX)))
-    {
-      tmpPoint = new PointDouble(xVal, boundaryMinY);
-      tmpEdge = findBoundingSegment(*tmpPoint, corners::bottom_right, geo::axis::horizontal, geo::order::descending);
-      if (tmpEdge == nullptr)
-      {
-        std::cerr << "Calculations failed\n";
-        exit(-1);
-      }
-      else
-      {
-        if (compareDoublePointEqual(*tmpEdge->from(), *tmpPoint))
-        {
-          delete tmpPoint;
-          pointOnBoundary = tmpEdge;
-        }
-        else
-        {
-          diagramVertices.push_back(tmpPoint);
-          geo::insertPointInEdge(tmpPoint, tmpEdge);
-          pointOnBoundary = tmpEdge->next();
-        }
-      }
-    }
+    std::cerr << "Calculations failed\n";
+    exit(-1);
   }
+  return hits[count - 1].edge;
+}
 
-  if (!compareDoubleEqual(normal.x, 0.0))
-  {
-    // check against left boundary
-    t = (boundaryMinX - point.x) / normal.x;
-    auto yVal = (point.y + normal.y * t);
-
-    // y_min <= y < y_max
-    if (t > 0 && (compareDoubleEqual(yVal, boundaryMinY) || (yVal > boundaryMinY && yVal < boundaryMaxY)))
-    {
-      tmpPoint = new PointDouble(boundaryMinX, yVal);
-      tmpEdge = findBoundingSegment(*tmpPoint, corners::bottom_left, geo::axis::vertical, geo::order::ascending);
-      if (tmpEdge == nullptr)
-      {
-        std::cerr << "Calculations failed\n";
-        exit(-1);
-      }
-      else
-      {
-        if (compareDoublePointEqual(*tmpEdge->from(), *tmpPoint))
-        {
-          delete tmpPoint;
-          pointOnBoundary = tmpEdge;
-        }
-        else
-        {
-          diagramVertices.push_back(tmpPoint);
-          geo::insertPointInEdge(tmpPoint, tmpEdge);
-          pointOnBoundary = tmpEdge->next();
-        }
-      }
-    }
-
-    // check against right boundary
-    t = (boundaryMaxX - point.x) / normal.x;
-    yVal = (point.y + normal.y * t);
-
-    // y_min < y <= y_max
-    if (t > 0 && (compareDoubleEqual(yVal, boundaryMaxY) || (yVal >= boundaryMinY && yVal <= boundaryMaxY)))
-    {
-      tmpPoint = new PointDouble(boundaryMaxX, yVal);
-      tmpEdge = findBoundingSegment(*tmpPoint, corners::top_right, geo::axis::vertical, geo::order::descending);
-      if (tmpEdge == nullptr)
-      {
-        std::cerr << "Calculations failed\n";
-        exit(-1);
-      }
-      else
-      {
-        if (compareDoublePointEqual(*tmpEdge->from(), *tmpPoint))
-        {
-          delete tmpPoint;
-          pointOnBoundary = tmpEdge;
-        }
-        else
-        {
-          diagramVertices.push_back(tmpPoint);
-          geo::insertPointInEdge(tmpPoint, tmpEdge);
-          pointOnBoundary = tmpEdge->next();
-        }
-      }
-    }
-  }
+HalfEdge<double> *Voronoi::createSemiInfiniteEdge(HalfEdge<int> *edge, bool reverse)
+{
+  HalfEdge<double> *pointOnBoundary = clipHullRay(edge);
+  HalfEdge<double> *tmpEdge, *neighboorEdge;
 
   auto neighboorEdgeInt = !reverse ? edge->twin()->next() : edge->twin()->prev()->twin();
   Face<double> *newFace, *oldFace;
   HalfEdge<double> *newEdge;
-  if (edgeReference.count(neighboorEdgeInt) > 0)
+  neighboorEdge = edgeReference[neighboorEdgeInt->getId()];
+  if (neighboorEdge != nullptr)
   {
     oldFace = pointOnBoundary->face();
-    neighboorEdge = edgeReference[neighboorEdgeInt];
     tmpEdge = !reverse ? neighboorEdge->next() : neighboorEdge;
-    newFace = geo::insertDiagonal(tmpEdge, pointOnBoundary, &newEdge, true);
+    newFace = geo::insertDiagonal(arena, tmpEdge, pointOnBoundary, &newEdge, true);
     // If the cell is open, then the old face was overwritten.
     if (newEdge->face() != oldFace)
     {
       geo::setFace(newEdge, oldFace);
-      delete newFace;
+      arena.faces.destroy(newFace);
     }
     else
     {
-      diagramFaces.push_back(newFace);
-      faceReference[edge->to()] = newEdge->face();
-      faceReference[edge->from()] = newEdge->twin()->face();
+      addFace(newFace);
+      faceReference[siteIndex(edge->to())] = newEdge->face();
+      faceReference[siteIndex(edge->from())] = newEdge->twin()->face();
     }
     newEdge = newEdge->twin();
   }
   else
   {
-    auto circuncenter = triangleCircuncenters[edge->twin()->face()];
-    newEdge = geo::createEdgeP2E(circuncenter, pointOnBoundary);
+    auto circuncenter = triangleCircuncenters[edge->twin()->face()->getId()];
+    newEdge = geo::createEdgeP2E(arena, circuncenter, pointOnBoundary);
   }
 
-  edgeReference[edge] = newEdge;
-  edgeReference[edge->twin()] = newEdge->twin();
+  edgeReference[edge->getId()] = newEdge;
+  edgeReference[edge->twin()->getId()] = newEdge->twin();
 
   return newEdge;
 }
@@ -579,60 +736,457 @@ HalfEdge<double> *Voronoi::createEdge(HalfEdge<int> *edge)
   Face<double> *newFace, *oldFace;
 
   leftNeighboorInt = edge->twin()->next();
-  if (edgeReference.count(leftNeighboorInt) > 0)
-    leftNeighboor = edgeReference[leftNeighboorInt];
-  else
-    leftNeighboor = nullptr;
+  leftNeighboor = edgeReference[leftNeighboorInt->getId()];
 
   rightNeighboorInt = edge->prev()->twin();
-  if (edgeReference.count(rightNeighboorInt) > 0)
-    rightNeighboor = edgeReference[rightNeighboorInt];
-  else
-    rightNeighboor = nullptr;
+  rightNeighboor = edgeReference[rightNeighboorInt->getId()];
 
   if (leftNeighboor != nullptr && rightNeighboor != nullptr)
   {
     oldFace = rightNeighboor->face();
-    newFace = geo::insertDiagonal(leftNeighboor->next(), rightNeighboor, &newEdge, true);
+    newFace = geo::insertDiagonal(arena, leftNeighboor->next(), rightNeighboor, &newEdge, true);
 
     if (newEdge->face() != oldFace)
     {
       geo::setFace(newEdge, oldFace);
-      delete newFace;
+      arena.faces.destroy(newFace);
     }
     else
     {
-      faceReference[edge->to()] = newEdge->face();
-      faceReference[edge->from()] = newEdge->twin()->face();
-      diagramFaces.push_back(newFace);
+      faceReference[siteIndex(edge->to())] = newEdge->face();
+      faceReference[siteIndex(edge->from())] = newEdge->twin()->face();
+      addFace(newFace);
     }
     newEdge = newEdge->twin();
   }
   else
   {
-    auto circ1 = triangleCircuncenters[edge->twin()->face()];
-    auto circ2 = triangleCircuncenters[edge->face()];
+    auto circ1 = triangleCircuncenters[edge->twin()->face()->getId()];
+    auto circ2 = triangleCircuncenters[edge->face()->getId()];
     if (leftNeighboor == nullptr && rightNeighboor == nullptr)
     {
-      auto f = faceReference[edge->from()];
-      newEdge = geo::createEdgeP2P(circ1, circ2, f, f);
+      auto f = faceReference[siteIndex(edge->from())];
+      newEdge = geo::createEdgeP2P(arena, circ1, circ2, f, f);
     }
     else
     {
       if (leftNeighboor == nullptr)
       {
-        newEdge = geo::createEdgeP2E(circ1, rightNeighboor);
+        newEdge = geo::createEdgeP2E(arena, circ1, rightNeighboor);
       }
       else
       {
-        newEdge = geo::createEdgeP2E(circ2, leftNeighboor->next());
+        newEdge = geo::createEdgeP2E(arena, circ2, leftNeighboor->next());
         newEdge = newEdge->twin();
       }
     }
   }
 
-  edgeReference[edge] = newEdge;
-  edgeReference[edge->twin()] = newEdge->twin();
+  edgeReference[edge->getId()] = newEdge;
+  edgeReference[edge->twin()->getId()] = newEdge->twin();
 
   return newEdge;
-}
\ No newline at end of file
+}
+
+void Voronoi::removeEdge(HalfEdge<double> *edge)
+{
+  auto twin = edge->twin();
+
+  // move the handles of both endpoints to the next edge of their stars, if any
+  if (edge->from()->outgoingEdge() == edge)
+    edge->from()->setOutgoingEdge(twin->next() != edge ? twin->next() : nullptr);
+  if (twin->from()->outgoingEdge() == twin)
+    twin->from()->setOutgoingEdge(edge->next() != twin ? edge->next() : nullptr);
+
+  edge->next()->setPrev(twin->prev());
+  twin->prev()->setNext(edge->next());
+  edge->prev()->setNext(twin->next());
+  twin->next()->setPrev(edge->prev());
+
+  arena.edges.destroy(edge);
+  arena.edges.destroy(twin);
+}
+
+void Voronoi::removeBoundaryPoint(PointDouble *p)
+{
+  // inner segments u -> p -> w become u -> w, and their outer twins w -> p -> u become w -> u
+  auto out = p->outgoingEdge()->face() != nullptr ? p->outgoingEdge() : p->outgoingEdge()->twin()->next();
+  auto in = out->prev();
+  auto outerIn = out->twin(), outerOut = in->twin();
+  auto u = in->from(), w = out->to();
+
+  in->setTo(w);
+  outerIn->setTo(u);
+  in->setTwin(outerIn);
+  outerIn->setTwin(in);
+  in->setNext(out->next());
+  out->next()->setPrev(in);
+  outerIn->setNext(outerOut->next());
+  outerOut->next()->setPrev(outerIn);
+  if (in->face() != nullptr && in->face()->edgeChain() == out)
+    in->face()->setChain(in);
+
+  if (p->y == boundaryMaxY)
+    boundaryIndex[int(corners::top_left)].erase(p->x);
+  else if (p->y == boundaryMinY)
+    boundaryIndex[int(corners::bottom_right)].erase(-p->x);
+  else if (p->x == boundaryMinX)
+    boundaryIndex[int(corners::bottom_left)].erase(p->y);
+  else
+    boundaryIndex[int(corners::top_right)].erase(-p->y);
+
+  arena.edges.destroy(out);
+  arena.edges.destroy(outerOut);
+  removeVertex(p);
+}
+
+PointDouble Voronoi::edgeDirection(HalfEdge<double> const *edge) const
+{
+  auto cell = edge->face(), other = edge->twin()->face();
+  PointInt const *site = cell != nullptr ? siteFaceReference[cell->getId()] : nullptr;
+  PointInt const *otherSite = other != nullptr ? siteFaceReference[other->getId()] : nullptr;
+  if (site == nullptr || otherSite == nullptr)
+    return PointDouble(edge->to()->x - edge->from()->x, edge->to()->y - edge->from()->y);
+  return PointDouble(otherSite->y - site->y, site->x - otherSite->x);
+}
+
+HalfEdge<double> *Voronoi::spliceEdge(PointDouble *from, PointDouble *to, Face<double> *cell, Face<double> *otherCell)
+{
+  auto edge = arena.edges.create(from, to);
+  auto twin = arena.edges.create(to, from);
+  edge->setTwin(twin);
+  twin->setTwin(edge);
+  edge->setFace(cell);
+  twin->setFace(otherCell);
+
+  for (auto e : {edge, twin})
+  {
+    auto origin = e->from();
+    if (origin->outgoingEdge() == nullptr)
+    {
+      e->twin()->setNext(e);
+      e->setPrev(e->twin());
+      origin->setOutgoingEdge(e);
+      continue;
+    }
+
+    // the edge goes right after the outgoing edge that is closest to it clockwise
+    auto angle = [this](HalfEdge<double> const *h) {
+      auto direction = edgeDirection(h);
+      return atan2(direction.y, direction.x);
+    };
+    double eAngle = angle(e), closest = 0;
+    HalfEdge<double> *before = nullptr;
+    for (auto const &o : origin->outgoingEdges())
+    {
+      double turn = eAngle - angle(o);
+      if (turn < 0)
+        turn += 2 * M_PI;
+      if (before == nullptr || turn < closest)
+        before = o, closest = turn;
+    }
+
+    auto after = before->twin()->next();
+    before->twin()->setNext(e);
+    e->setPrev(before->twin());
+    e->twin()->setNext(after);
+    after->setPrev(e->twin());
+  }
+  return edge;
+}
+
+/**
+ * Bounding box of the sites of a triangulation, from the vertices of its hull. The hull is walked from the first
+ * candidate found on it; return false if there is none.
+ */
+static bool hullBounds(std::vector<PointInt *> const &candidates, int &minX, int &maxX, int &minY, int &maxY)
+{
+  HalfEdge<int> *start = nullptr;
+  for (auto const &s : candidates)
+  {
+    for (auto const &e : s->outgoingEdges())
+    {
+      if (e->face() == nullptr && e->twin()->face() != nullptr)
+        start = e;
+    }
+    if (start != nullptr)
+      break;
+  }
+  if (start == nullptr)
+    return false;
+
+  minX = maxX = start->from()->x;
+  minY = maxY = start->from()->y;
+  auto e = start;
+  do
+  {
+    minX = std::min(minX, e->from()->x);
+    maxX = std::max(maxX, e->from()->x);
+    minY = std::min(minY, e->from()->y);
+    maxY = std::max(maxY, e->from()->y);
+    e = e->next();
+  } while (e != start);
+  return true;
+}
+
+/**
+ * Repair the diagram after a change in the triangulation:
+ * 
+ * 1. The region to rebuild is the union of the cells of the sites whose star changed (and of the removed site),
+ *    and of the hull sites if moved sites changed the box
+ * 2. Delete the edges between two cells of the region, and the points where the deleted rays met the box, then
+ *    resize the box if needed
+ * 3. Compute the circuncenters of the new triangles, sharing the vertex of a neighbor when they coincide
+ * 4. Splice in the edges of the triangulation between two changed sites: edges between triangles join their
+ *    circuncenters, hull edges become rays clipped to the box
+ * 5. Walk the cycles of the region and give each one the cell of its site
+ * 6. Destroy the vertices left without edges
+ */
+void Voronoi::update(Delaunay const &del, DelaunayUpdate const &change)
+{
+  auto inserted = change.insertedSite;
+  bool outside = inserted != nullptr && !(inserted->x > boundaryMinX && inserted->x < boundaryMaxX && inserted->y > boundaryMinY && inserted->y < boundaryMaxY);
+  if (change.rebuilt || outside || (change.moved && 2 * change.sites.size() > sites.size()))
+  {
+    clear();
+    build(del);
+    return;
+  }
+  if (change.sites.empty() && change.removedSite == nullptr)
+    return;
+
+  // Moved sites may change the bounding box. Then every ray is clipped again: the cells of the hull sites join
+  // the region, so the rays and the points of the box all go before the box is resized.
+  std::vector<PointInt *> changedSites = change.sites;
+  int minX = 0, maxX = 0, minY = 0, maxY = 0;
+  bool resize = false;
+  if (change.moved)
+  {
+    std::vector<PointInt *> hull;
+    for (auto const &side : boundaryIndex)
+    {
+      for (auto const &point : side)
+      {
+        auto cell = point.second->face();
+        if (cell != nullptr && siteFaceReference[cell->getId()] != nullptr)
+          hull.push_back(siteFaceReference[cell->getId()]);
+      }
+    }
+    if (!hullBounds(hull, minX, maxX, minY, maxY) && !hullBounds(change.sites, minX, maxX, minY, maxY))
+    {
+      clear();
+      build(del);
+      return;
+    }
+
+    resize = minX - 5 != boundaryMinX || maxX + 5 != boundaryMaxX || minY - 5 != boundaryMinY || maxY + 5 != boundaryMaxY;
+    if (resize)
+    {
+      std::unordered_set<PointInt *> moved(change.sites.begin(), change.sites.end());
+      for (auto const &s : hull)
+      {
+        if (moved.insert(s).second)
+          changedSites.push_back(s);
+      }
+    }
+  }
+
+  // keep the site tables parallel to the points of the triangulation
+  Face<double> *removedCell = nullptr;
+  if (change.removedSite != nullptr)
+  {
+    size_t index = size_t(siteIndex(change.removedSite));
+    removedCell = faceReference[index];
+    if (removedCell != nullptr && siteFaceReference[removedCell->getId()] != change.removedSite)
+      removedCell = nullptr;
+    sites[index] = sites.back();
+    faceReference[index] = faceReference.back();
+    sites.pop_back();
+    faceReference.pop_back();
+  }
+  if (inserted != nullptr)
+  {
+    sites.push_back(inserted);
+    faceReference.push_back(nullptr);
+  }
+
+  std::unordered_set<PointInt *> changed(changedSites.begin(), changedSites.end());
+  std::vector<Face<double> *> region;
+  for (auto const &s : changedSites)
+  {
+    if (faceReference[siteIndex(s)] != nullptr)
+      region.push_back(faceReference[siteIndex(s)]);
+  }
+  if (removedCell != nullptr)
+    region.push_back(removedCell);
+  std::unordered_set<Face<double> *> inRegion(region.begin(), region.end());
+
+  // edges inside the region go, edges on its border stay with the site of their cell
+  std::vector<HalfEdge<double> *> doomed;
+  std::vector<std::pair<HalfEdge<double> *, PointInt *>> border;
+  for (auto const &f : region)
+  {
+    auto site = siteFaceReference[f->getId()];
+    auto e = f->edgeChain();
+    do
+    {
+      auto other = e->twin()->face();
+      if (other != nullptr && inRegion.count(other) > 0)
+        doomed.push_back(e);
+      else if (other != nullptr)
+        border.push_back({e, site});
+      e = e->next();
+    } while (e != f->edgeChain());
+  }
+
+  std::vector<PointDouble *> loose;
+  std::unordered_set<PointDouble *> seen;
+  auto addLoose = [&](PointDouble *v) {
+    if (v != nullptr && seen.insert(v).second)
+      loose.push_back(v);
+  };
+  std::unordered_set<HalfEdge<double> *> deleted;
+  for (auto const &e : doomed)
+  {
+    if (deleted.count(e) > 0)
+      continue;
+    deleted.insert(e);
+    deleted.insert(e->twin());
+    addLoose(e->from());
+    addLoose(e->to());
+    removeEdge(e);
+  }
+
+  // a point of the box that only the sides meet now is no longer needed
+  for (auto &v : loose)
+  {
+    if (v->outgoingEdge() == nullptr)
+      continue;
+    int degree = 0;
+    bool onBox = false;
+    for (auto const &o : v->outgoingEdges())
+    {
+      degree++;
+      onBox = onBox || o->face() == nullptr || o->twin()->face() == nullptr;
+    }
+    bool corner = (v->x == boundaryMinX || v->x == boundaryMaxX) && (v->y == boundaryMinY || v->y == boundaryMaxY);
+    if (onBox && !corner && degree == 2)
+    {
+      removeBoundaryPoint(v);
+      v = nullptr;
+    }
+  }
+  if (resize)
+    resizeBoundary(minX - 5, maxX + 5, minY - 5, maxY + 5);
+
+  // circuncenters of the new triangles
+  triangleCircuncenters.resize(del.numFaceIds(), nullptr);
+  for (auto const &id : change.removedFaces)
+  {
+    addLoose(triangleCircuncenters[id]);
+    triangleCircuncenters[id] = nullptr;
+  }
+  for (auto const &f : change.faces)
+  {
+    addLoose(triangleCircuncenters[f->getId()]);
+    triangleCircuncenters[f->getId()] = nullptr;
+  }
+
+  CircuncenterBatch batch;
+  batch.resize(change.faces.size());
+  for (size_t i = 0; i < change.faces.size(); i++)
+  {
+    auto e = change.faces[i]->edgeChain();
+    batch.x1[i] = e->from()->x;
+    batch.y1[i] = e->from()->y;
+    batch.x2[i] = e->next()->from()->x;
+    batch.y2[i] = e->next()->from()->y;
+    batch.x3[i] = e->prev()->from()->x;
+    batch.y3[i] = e->prev()->from()->y;
+  }
+  batch.compute(0, change.faces.size());
+  for (size_t i = 0; i < change.faces.size(); i++)
+  {
+    PointDouble circuncenter(batch.centerX[i], batch.centerY[i]);
+    PointDouble *circuncenterPtr = nullptr;
+    auto e = change.faces[i]->edgeChain();
+    do
+    {
+      auto neighbor = e->twin()->face();
+      if (neighbor != nullptr && triangleCircuncenters[neighbor->getId()] != nullptr)
+      {
+        if (compareDoubleEqual(geo::computeDistance(circuncenter, *triangleCircuncenters[neighbor->getId()]), 0.0))
+          circuncenterPtr = triangleCircuncenters[neighbor->getId()];
+      }
+      e = e->next();
+    } while (e != change.faces[i]->edgeChain());
+
+    if (circuncenterPtr == nullptr)
+    {
+      circuncenterPtr = arena.points.create(circuncenter.x, circuncenter.y);
+      addVertex(circuncenterPtr);
+    }
+    else
+      STATS_ADD(mergedCircuncenters, 1);
+    triangleCircuncenters[change.faces[i]->getId()] = circuncenterPtr;
+  }
+
+  if (inserted != nullptr)
+  {
+    auto face = arena.faces.create();
+    addFace(face);
+    siteFaceReference[face->getId()] = inserted;
+    faceReference[siteIndex(inserted)] = face;
+  }
+
+  // the half-edge dual to a -> b is in the cell of a and goes from the circuncenter on the left of a -> b to the
+  // one on its right
+  std::vector<std::pair<HalfEdge<double> *, PointInt *>> created;
+  for (auto const &a : changedSites)
+  {
+    for (auto const &e : a->outgoingEdges())
+    {
+      auto b = e->to();
+      if (changed.count(b) == 0 || e->twin()->face() == nullptr)
+        continue;
+
+      HalfEdge<double> *edge;
+      auto left = triangleCircuncenters[e->twin()->face()->getId()];
+      auto cell = faceReference[siteIndex(a)], otherCell = faceReference[siteIndex(b)];
+      if (e->face() == nullptr)
+        edge = spliceEdge(left, clipHullRay(e)->from(), cell, otherCell);
+      else if (siteIndex(a) < siteIndex(b) && left != triangleCircuncenters[e->face()->getId()])
+        edge = spliceEdge(left, triangleCircuncenters[e->face()->getId()], cell, otherCell);
+      else
+        continue;
+      created.push_back({edge, a});
+      created.push_back({edge->twin(), b});
+    }
+  }
+
+  std::unordered_set<HalfEdge<double> *> visited;
+  auto assignCell = [&](HalfEdge<double> *start, PointInt *site) {
+    if (visited.count(start) > 0)
+      return;
+    auto e = start;
+    do
+    {
+      visited.insert(e);
+      e = e->next();
+    } while (e != start);
+
+    geo::setFace(start, faceReference[siteIndex(site)]);
+  };
+  for (auto const &c : created)
+    assignCell(c.first, c.second);
+  for (auto const &b : border)
+    assignCell(b.first, b.second);
+
+  if (removedCell != nullptr)
+    removeFace(removedCell);
+  for (auto const &v : loose)
+  {
+    if (v != nullptr && v->outgoingEdge() == nullptr)
+      removeVertex(v);
+  }
+}
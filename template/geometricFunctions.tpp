@@ -9,13 +9,15 @@ namespace geo
 {
 
   template <typename T>
-  HalfEdge<T> *createEdgeP2P(Point<T> *from, Point<T> *to, Face<T> *leftFace, Face<T> *rightFace)
+  HalfEdge<T> *createEdgeP2P(DcelArena<T> &arena, Point<T> *from, Point<T> *to, Face<T> *leftFace, Face<T> *rightFace)
   {
-    auto edge = new HalfEdge<T>(from, to);
-    from->insertIncidentEdge(edge);
+    auto edge = arena.edges.create(from, to);
+    if (from->outgoingEdge() == nullptr)
+      from->setOutgoingEdge(edge);
 
-    auto twin = new HalfEdge<T>(to, from, edge, edge, edge);
-    to->insertIncidentEdge(twin);
+    auto twin = arena.edges.create(to, from, edge, edge, edge);
+    if (to->outgoingEdge() == nullptr)
+      to->setOutgoingEdge(twin);
     twin->setFace(leftFace);
 
     edge->setTwin(twin);
@@ -27,14 +29,14 @@ namespace geo
   }
 
   template <typename T>
-  HalfEdge<T> *createEdgeP2E(Point<T> *from, HalfEdge<T> *toEdge)
+  HalfEdge<T> *createEdgeP2E(DcelArena<T> &arena, Point<T> *from, HalfEdge<T> *toEdge)
   {
-    auto edge = new HalfEdge<T>(from, toEdge->from(), nullptr, toEdge, nullptr);
-    from->insertIncidentEdge(edge);
+    auto edge = arena.edges.create(from, toEdge->from(), nullptr, toEdge, nullptr);
+    if (from->outgoingEdge() == nullptr)
+      from->setOutgoingEdge(edge);
     edge->setFace(toEdge->face());
 
-    auto twin = new HalfEdge<T>(toEdge->from(), from, toEdge->prev(), edge, edge);
-    toEdge->from()->insertIncidentEdge(twin);
+    auto twin = arena.edges.create(toEdge->from(), from, toEdge->prev(), edge, edge);
     edge->setTwin(twin);
     edge->setPrev(twin);
     twin->setFace(toEdge->face());
@@ -65,14 +67,14 @@ namespace geo
   }
 
   template <typename T>
-  void insertPointInEdge(Point<T> *p, HalfEdge<T> *edge)
+  void insertPointInEdge(DcelArena<T> &arena, Point<T> *p, HalfEdge<T> *edge)
   {
-    HalfEdge<T> *tmp1 = new HalfEdge<T>(p, edge->to(), edge, edge->next(), nullptr);
+    HalfEdge<T> *tmp1 = arena.edges.create(p, edge->to(), edge, edge->next(), nullptr);
     tmp1->setFace(edge->face());
-    p->insertIncidentEdge(tmp1);
-    HalfEdge<T> *tmp2 = new HalfEdge<T>(p, edge->from(), edge->twin(), edge->twin()->next(), edge);
+    if (p->outgoingEdge() == nullptr)
+      p->setOutgoingEdge(tmp1);
+    HalfEdge<T> *tmp2 = arena.edges.create(p, edge->from(), edge->twin(), edge->twin()->next(), edge);
     tmp2->setFace(edge->twin()->face());
-    p->insertIncidentEdge(tmp2);
 
     edge->setTo(p);
     edge->twin()->setTo(p);
@@ -91,21 +93,19 @@ namespace geo
   }
 
   template <typename T>
-  Face<T> *insertDiagonal(HalfEdge<T> *fromEdge, HalfEdge<T> *toEdge)
+  Face<T> *insertDiagonal(DcelArena<T> &arena, HalfEdge<T> *fromEdge, HalfEdge<T> *toEdge)
   {
     HalfEdge<T> *tmp;
-    return insertDiagonal(fromEdge, toEdge, &tmp, true);
+    return insertDiagonal(arena, fromEdge, toEdge, &tmp, true);
   }
 
   template <typename T>
-  Face<T> *insertDiagonal(HalfEdge<T> *fromEdge, HalfEdge<T> *toEdge, HalfEdge<T> **newEdge, bool computeFace)
+  Face<T> *insertDiagonal(DcelArena<T> &arena, HalfEdge<T> *fromEdge, HalfEdge<T> *toEdge, HalfEdge<T> **newEdge, bool computeFace)
   {
     // Create diagonal and its twin
-    auto diagonal = new HalfEdge<T>(toEdge->from(), fromEdge->from(), toEdge->prev(), fromEdge, nullptr);
+    auto diagonal = arena.edges.create(toEdge->from(), fromEdge->from(), toEdge->prev(), fromEdge, nullptr);
     *newEdge = diagonal;
-    toEdge->from()->insertIncidentEdge(diagonal);
-    auto diagonalTwin = new HalfEdge<T>(fromEdge->from(), toEdge->from(), fromEdge->prev(), toEdge, diagonal);
-    fromEdge->from()->insertIncidentEdge(diagonalTwin);
+    auto diagonalTwin = arena.edges.create(fromEdge->from(), toEdge->from(), fromEdge->prev(), toEdge, diagonal);
 
     // Update edge chain
     diagonal->setTwin(diagonalTwin);
@@ -118,7 +118,7 @@ namespace geo
     Face<T> *face = nullptr;
     if (computeFace)
     {
-      face = new Face<T>();
+      face = arena.faces.create();
 
       // Update face
       setFace(diagonal, fromEdge->face());
@@ -129,53 +129,69 @@ namespace geo
   }
 
   template <typename T>
-  void legalizeEdge(Point<T> *p, HalfEdge<T> *edge)
+  void flipEdge(HalfEdge<T> *edge)
   {
     auto twin = edge->twin();
-    if (twin->face() != nullptr)
-    {
-      PointDouble pd = computeCircuncenter(PointDouble(*p), PointDouble(*(edge->from())), PointDouble(*(edge->to())));
-
-      double r = computeDistance(pd, PointDouble(*p));
-      double dist = computeDistance(pd, PointDouble(*(twin->next()->to())));
 
-      if (dist < r)
-      {
-        // flip edge
-        edge->from()->removeIncidentEdge(edge);
-        edge->to()->removeIncidentEdge(twin);
+    // move the endpoints' handles away from the edge
+    if (edge->from()->outgoingEdge() == edge)
+      edge->from()->setOutgoingEdge(twin->next());
+    if (twin->from()->outgoingEdge() == twin)
+      twin->from()->setOutgoingEdge(edge->next());
 
-        edge->next()->setPrev(twin->prev());
-        twin->prev()->setNext(edge->next());
+    edge->next()->setPrev(twin->prev());
+    twin->prev()->setNext(edge->next());
 
-        edge->prev()->setNext(twin->next());
-        twin->next()->setPrev(edge->prev());
+    edge->prev()->setNext(twin->next());
+    twin->next()->setPrev(edge->prev());
 
-        edge->setFrom(twin->next()->to());
-        edge->from()->insertIncidentEdge(edge);
-        twin->setTo(edge->from());
+    edge->setFrom(twin->next()->to());
+    twin->setTo(edge->from());
 
-        twin->setFrom(edge->next()->to());
-        twin->from()->insertIncidentEdge(twin);
-        edge->setTo(twin->from());
+    twin->setFrom(edge->next()->to());
+    edge->setTo(twin->from());
 
-        edge->setPrev(twin->next());
-        edge->prev()->setNext(edge);
+    edge->setPrev(twin->next());
+    edge->prev()->setNext(edge);
 
-        twin->setPrev(edge->next());
-        twin->prev()->setNext(twin);
+    twin->setPrev(edge->next());
+    twin->prev()->setNext(twin);
 
-        edge->setNext(edge->prev()->prev());
-        edge->next()->setPrev(edge);
+    edge->setNext(edge->prev()->prev());
+    edge->next()->setPrev(edge);
 
-        twin->setNext(twin->prev()->prev());
-        twin->next()->setPrev(twin);
+    twin->setNext(twin->prev()->prev());
+    twin->next()->setPrev(twin);
 
-        setFace(edge, edge->face());
-        setFace(twin, twin->face());
+    setFace(edge, edge->face());
+    setFace(twin, twin->face());
+  }
 
-        legalizeEdge(p, edge->prev());
-        legalizeEdge(p, twin->next());
+  template <typename T>
+  void legalizeEdge(Point<T> *p, HalfEdge<T> *edge, HistoryDag<T> *history)
+  {
+    auto twin = edge->twin();
+    if (twin->face() != nullptr)
+    {
+      // faces are clockwise, so (to, from, p) is counterclockwise
+      if (incircle(*edge->to(), *edge->from(), *p, *twin->next()->to()) > 0)
+      {
+        STATS_ONLY(stats.enterFlip());
+        HistoryNode<T> *node1 = nullptr, *node2 = nullptr;
+        if (history != nullptr)
+        {
+          node1 = history->leaf(edge->face());
+          node2 = history->leaf(twin->face());
+        }
+
+        flipEdge(edge);
+
+        if (history != nullptr)
+          history->replace({node1, node2}, {edge->face(), twin->face()});
+
+        legalizeEdge(p, edge->prev(), history);
+        legalizeEdge(p, twin->next(), history);
+        STATS_ONLY(stats.leaveFlip());
       }
     }
   }